@@ -28,7 +28,9 @@
 #  define _CRT_DISABLE_PERFCRIT_LOCKS
 #else
 #  define _FILE_OFFSET_BITS 64
-#  define _ftelli64 ftello64
+#  define _POSIX_C_SOURCE 200112L
+#  define _fseeki64 fseeko
+#  define _ftelli64 ftello
 #endif
 
 #ifdef __MINGW32__
@@ -41,12 +43,33 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#if defined(_WIN32)
+#  include <fcntl.h>
+#  include <io.h>
+#endif
+
+#include "blz4_thread.h"
 #include "lz4.h"
 #include "parg.h"
 
 #define LZ4_LEGACY_MAGIC (0x184C2102UL)
+#define LZ4_FRAME_MAGIC (0x184D2204UL)
+#define LZ4_SKIPPABLE_MAGIC (0x184D2A50UL)
+#define LZ4_SKIPPABLE_MASK (0xFFFFFFF0UL)
+
+/*
+ * Bit set in the size of blocks stored uncompressed in LZ4 frames.
+ */
+#define LZ4_FRAME_BLOCK_UNCOMPRESSED (0x80000000UL)
+
+/*
+ * Maximum size of LZ4 frame header, magic, FLG, BD, content size and
+ * header checksum.
+ */
+#define LZ4_FRAME_HEADER_MAX (4 + 2 + 8 + 1)
 
 /*
  * The default block size used to process data.
@@ -55,6 +78,11 @@
 #  define BLOCK_SIZE (8 * 1024 * 1024UL)
 #endif
 
+/*
+ * Maximum number of threads.
+ */
+#define MAX_THREADS 256
+
 /*
  * Unsigned char type.
  */
@@ -93,6 +121,17 @@ read_le32(const byte *p)
 	     | ((unsigned long) octet(p[3]) << 24);
 }
 
+/*
+ * Options for writing the LZ4 frame format.
+ */
+struct frame_options {
+	int block_size_id;    /* Maximum block size, 4 (64 KiB) to 7 (4 MiB) */
+	int linked;           /* Blocks may refer to previous blocks */
+	int block_checksum;   /* Store checksum of each block */
+	int content_checksum; /* Store checksum of uncompressed data */
+	int content_size;     /* Store size of uncompressed data */
+};
+
 static unsigned int
 ratio(long long x, long long y)
 {
@@ -110,6 +149,44 @@ ratio(long long x, long long y)
 	return (unsigned int) (x / y);
 }
 
+/*
+ * Get time in seconds from a monotonic wall clock.
+ */
+static double
+get_time(void)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER count, freq;
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+
+	return (double) count.QuadPart / (double) freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+#endif
+}
+
+static double
+mb_per_sec(long long size, double secs)
+{
+	return secs > 0.0 ? (double) size / (1024.0 * 1024.0) / secs : 0.0;
+}
+
+static void
+show_progress(void)
+{
+	static const char rotator[] = "-\\|/";
+	static unsigned int counter = 0;
+
+	fprintf(stderr, "%c\r", rotator[counter]);
+	counter = (counter + 1) & 0x03;
+}
+
 static void
 printf_error(const char *fmt, ...)
 {
@@ -136,316 +213,2138 @@ printf_usage(const char *fmt, ...)
 	va_end(arg);
 
 	fputs("\n"
-	      "usage: blz4 [-56789 | --optimal] [-v] INFILE OUTFILE\n"
-	      "       blz4 -d [-v] INFILE OUTFILE\n"
+	      "usage: blz4 [-123456789 | --optimal] [--parser=NAME] [--hash-bits=N]\n"
+	      "            [--depth=N] [--accept=N] [--window=N] [--kernel=NAME] [-v]\n"
+	      "            [-T N] [--frame] [-B ID] [--linked] [--checksum]\n"
+	      "            [--block-checksum] [--content-checksum] [--content-size]\n"
+	      "            [--index] [--stats[=FORMAT]] INFILE OUTFILE\n"
+	      "       blz4 -d [--kernel=NAME] [-T N] [-v] [--stats[=FORMAT]] INFILE OUTFILE\n"
+	      "       blz4 -b [-123456789 | --optimal] [-e LEVEL] [-i N] [--parser=NAME]\n"
+	      "            [--kernel=NAME] FILE...\n"
+	      "       blz4 --peek=N [--kernel=NAME] INFILE [OUTFILE]\n"
+	      "       blz4 --range=BEGIN:END [--kernel=NAME] INFILE [OUTFILE]\n"
 	      "       blz4 -V | --version\n"
 	      "       blz4 -h | --help\n", stderr);
 }
 
-static int
-compress_file(const char *oldname, const char *packedname, int be_verbose,
-              int level)
+/*
+ * Get maximum block size for LZ4 frame block size ID.
+ */
+static unsigned long
+frame_block_size(int block_size_id)
 {
-	const byte lz4_magic[4] = { 0x02, 0x21, 0x4C, 0x18 };
-	byte header[4];
-	FILE *oldfile = NULL;
-	FILE *packedfile = NULL;
-	byte *data = NULL;
-	byte *packed = NULL;
-	byte *workmem = NULL;
-	long long insize = 0, outsize = 0;
-	static const char rotator[] = "-\\|/";
-	unsigned int counter = 0;
-	size_t n_read;
-	clock_t clocks;
-	int res = 1;
+	return 1UL << (8 + 2 * block_size_id);
+}
 
-	/* Allocate memory */
-	if ((data = (byte *) malloc(BLOCK_SIZE)) == NULL
-	 || (packed = (byte *) malloc(lz4_max_packed_size(BLOCK_SIZE))) == NULL
-	 || (workmem = (byte *) malloc(lz4_workmem_size_level(BLOCK_SIZE, level))) == NULL) {
-		printf_error("not enough memory");
-		goto out;
-	}
+/*
+ * Write LZ4 frame header to `p`, returning the size of the header.
+ */
+static size_t
+write_frame_header(byte *p, const struct frame_options *frame,
+                   long long content_size)
+{
+	size_t size = 6;
 
-	/* Open input file */
-	if ((oldfile = fopen(oldname, "rb")) == NULL) {
-		printf_usage("unable to open input file '%s'", oldname);
-		goto out;
+	write_le32(p, LZ4_FRAME_MAGIC);
+
+	/* FLG byte with version 01 */
+	p[4] = 0x40;
+
+	if (!frame->linked) {
+		p[4] |= 0x20;
+	}
+	if (frame->block_checksum) {
+		p[4] |= 0x10;
+	}
+	if (frame->content_size) {
+		p[4] |= 0x08;
+	}
+	if (frame->content_checksum) {
+		p[4] |= 0x04;
 	}
 
-	/* Create output file */
-	if ((packedfile = fopen(packedname, "wb")) == NULL) {
-		printf_usage("unable to open output file '%s'", packedname);
-		goto out;
+	/* BD byte */
+	p[5] = octet(frame->block_size_id << 4);
+
+	if (frame->content_size) {
+		write_le32(p + 6, (unsigned long) (content_size & 0xFFFFFFFFLL));
+		write_le32(p + 10, (unsigned long) (content_size >> 32));
+		size += 8;
 	}
 
-	clocks = clock();
+	/* Header checksum of frame descriptor */
+	p[size] = octet(lz4_xxh32(p + 4, size - 4, 0) >> 8);
 
-	/* Write LZ4 header magic */
-	fwrite(lz4_magic, 1, sizeof(lz4_magic), packedfile);
-	outsize += sizeof(lz4_magic);
+	return size + 1;
+}
 
-	/* While we are able to read data from input file .. */
-	while ((n_read = fread(data, 1, BLOCK_SIZE, oldfile)) > 0) {
-		size_t packedsize;
+/*
+ * Pool of worker threads that process jobs in a ring buffer.
+ *
+ * The main thread fills jobs in order and submits them, workers take them
+ * in the same order, and the main thread then waits for each job in order.
+ * This way results can be written in order, regardless of the number of
+ * threads.
+ *
+ * Without threads, jobs are run on the main thread when submitted, using
+ * the data of the first worker.
+ */
+struct job_pool {
+	void (*work)(void *ctx, size_t job, void *worker_data);
+	void *ctx;
+	struct job_worker *workers;
+	size_t num_workers;
+	size_t num_started;
+	size_t num_jobs;
+	unsigned char *done;         /* Set for each job when it is done */
+	unsigned long num_submitted; /* Number of jobs handed out */
+	unsigned long next_job;      /* Next job a worker will take */
+	int threaded;
+	int quit;
+	struct blz4_mutex mutex;
+	struct blz4_cond work_cond;  /* Signalled when a job is handed out */
+	struct blz4_cond done_cond;  /* Signalled when a job is done */
+};
+
+struct job_worker {
+	struct job_pool *pool;
+	void *data;                  /* Data passed to work, like workmem */
+	struct blz4_thread thread;
+};
 
-		/* Show a little progress indicator */
-		if (be_verbose) {
-			fprintf(stderr, "%c\r", rotator[counter]);
-			counter = (counter + 1) & 0x03;
-		}
+static void
+job_worker_main(void *arg)
+{
+	struct job_worker *worker = (struct job_worker *) arg;
+	struct job_pool *pool = worker->pool;
 
-		/* Compress data block */
-		packedsize = lz4_pack_level(data, packed, (unsigned long) n_read,
-		                            workmem, level);
+	blz4_mutex_lock(&pool->mutex);
 
-		/* Check for compression error */
-		if (packedsize == 0) {
-			printf_error("an error occured while compressing");
-			goto out;
+	for (;;) {
+		size_t job;
+
+		while (!pool->quit && pool->next_job == pool->num_submitted) {
+			blz4_cond_wait(&pool->work_cond, &pool->mutex);
 		}
 
-		/* Put block-specific values into header */
-		write_le32(header, (unsigned long) packedsize);
+		if (pool->quit) {
+			break;
+		}
 
-		/* Write header and compressed data */
-		fwrite(header, 1, sizeof(header), packedfile);
-		fwrite(packed, 1, packedsize, packedfile);
+		job = pool->next_job++ % pool->num_jobs;
 
-		/* Sum input and output size */
-		insize += n_read;
-		outsize += packedsize + sizeof(header);
-	}
+		blz4_mutex_unlock(&pool->mutex);
 
-	clocks = clock() - clocks;
+		pool->work(pool->ctx, job, worker->data);
 
-	/* Show result */
-	if (be_verbose) {
-		fprintf(stderr, "in %lld out %lld ratio %u%% time %.2f\n",
-		        insize, outsize, ratio(outsize, insize),
-		        (double) clocks / (double) CLOCKS_PER_SEC);
+		blz4_mutex_lock(&pool->mutex);
+
+		pool->done[job] = 1;
+		blz4_cond_broadcast(&pool->done_cond);
 	}
 
-	res = 0;
+	blz4_mutex_unlock(&pool->mutex);
+}
 
-out:
-	/* Close files */
-	if (packedfile != NULL) {
-		fclose(packedfile);
-	}
-	if (oldfile != NULL) {
-		fclose(oldfile);
-	}
+/*
+ * Initialize pool using `num_threads` threads, which are started by
+ * job_pool_start. Two jobs per thread keeps them busy while the main
+ * thread is reading and writing.
+ *
+ * Returns 0 on success.
+ */
+static int
+job_pool_init(struct job_pool *pool, int num_threads,
+              void (*work)(void *, size_t, void *), void *ctx)
+{
+	pool->work = work;
+	pool->ctx = ctx;
+	pool->threaded = num_threads > 1;
+	pool->num_workers = pool->threaded ? (size_t) num_threads : 1;
+	pool->num_started = 0;
+	pool->num_jobs = pool->threaded ? 2 * pool->num_workers : 1;
+	pool->num_submitted = 0;
+	pool->next_job = 0;
+	pool->quit = 0;
+
+	blz4_mutex_init(&pool->mutex);
+	blz4_cond_init(&pool->work_cond);
+	blz4_cond_init(&pool->done_cond);
+
+	pool->workers = (struct job_worker *) calloc(pool->num_workers, sizeof(pool->workers[0]));
+	pool->done = (unsigned char *) calloc(pool->num_jobs, 1);
+
+	return pool->workers != NULL && pool->done != NULL ? 0 : -1;
+}
 
-	/* Free memory */
-	if (workmem != NULL) {
-		free(workmem);
-	}
-	if (packed != NULL) {
-		free(packed);
+/*
+ * Start worker threads, returning 0 on success.
+ */
+static int
+job_pool_start(struct job_pool *pool)
+{
+	if (!pool->threaded) {
+		return 0;
 	}
-	if (data != NULL) {
-		free(data);
+
+	for (; pool->num_started < pool->num_workers; ++pool->num_started) {
+		struct job_worker *worker = &pool->workers[pool->num_started];
+
+		worker->pool = pool;
+
+		if (blz4_thread_create(&worker->thread, job_worker_main, worker) != 0) {
+			printf_error("unable to create thread");
+			return -1;
+		}
 	}
 
-	return res;
+	return 0;
 }
 
-static int
-decompress_file(const char *packedname, const char *newname, int be_verbose)
+/*
+ * Get index of the job to fill before the next call to job_pool_submit.
+ */
+static size_t
+job_pool_next(const struct job_pool *pool)
 {
-	byte header[4];
-	FILE *newfile = NULL;
-	FILE *packedfile = NULL;
-	byte *data = NULL;
-	byte *packed = NULL;
-	long long insize = 0, outsize = 0;
-	static const char rotator[] = "-\\|/";
-	unsigned int counter = 0;
-	clock_t clocks;
-	size_t max_packed_size;
-	int res = 1;
+	return pool->num_submitted % pool->num_jobs;
+}
 
-	max_packed_size = lz4_max_packed_size(BLOCK_SIZE);
+static void
+job_pool_submit(struct job_pool *pool)
+{
+	const size_t job = job_pool_next(pool);
 
-	/* Allocate memory */
-	if ((data = (byte *) malloc(BLOCK_SIZE)) == NULL
-	 || (packed = (byte *) malloc(max_packed_size)) == NULL) {
-		printf_error("not enough memory");
-		goto out;
+	if (!pool->threaded) {
+		pool->work(pool->ctx, job, pool->workers[0].data);
+		pool->done[job] = 1;
+		++pool->num_submitted;
+		return;
 	}
 
-	/* Open input file */
-	if ((packedfile = fopen(packedname, "rb")) == NULL) {
-		printf_usage("unable to open input file '%s'", packedname);
-		goto out;
-	}
+	blz4_mutex_lock(&pool->mutex);
+	pool->done[job] = 0;
+	++pool->num_submitted;
+	blz4_cond_signal(&pool->work_cond);
+	blz4_mutex_unlock(&pool->mutex);
+}
 
-	/* Create output file */
-	if ((newfile = fopen(newname, "wb")) == NULL) {
-		printf_usage("unable to open output file '%s'", newname);
-		goto out;
+/*
+ * Wait for job number `seq` in submission order to be done, returning
+ * its index.
+ */
+static size_t
+job_pool_wait(struct job_pool *pool, unsigned long seq)
+{
+	const size_t job = seq % pool->num_jobs;
+
+	if (pool->threaded) {
+		blz4_mutex_lock(&pool->mutex);
+		while (!pool->done[job]) {
+			blz4_cond_wait(&pool->done_cond, &pool->mutex);
+		}
+		blz4_mutex_unlock(&pool->mutex);
 	}
 
-	clocks = clock();
+	return job;
+}
 
-	/* Read LZ4 header magic */
-	if (fread(header, 1, sizeof(header), packedfile) != sizeof(header)) {
-		printf_error("unable to read LZ4 header magic");
-		goto out;
+/*
+ * Stop worker threads and free pool, including worker data.
+ */
+static void
+job_pool_free(struct job_pool *pool)
+{
+	size_t i;
+
+	blz4_mutex_lock(&pool->mutex);
+	pool->quit = 1;
+	blz4_cond_broadcast(&pool->work_cond);
+	blz4_mutex_unlock(&pool->mutex);
+
+	for (i = 0; i < pool->num_started; ++i) {
+		blz4_thread_join(&pool->workers[i].thread);
 	}
 
-	/* Check header is LZ4 legacy magic */
-	if (read_le32(header) != LZ4_LEGACY_MAGIC) {
-		printf_error("LZ4 header magic mismatch");
-		goto out;
+	if (pool->workers != NULL) {
+		for (i = 0; i < pool->num_workers; ++i) {
+			free(pool->workers[i].data);
+		}
 	}
 
-	/* While we are able to read a header from input file .. */
-	while (fread(header, 1, sizeof(header), packedfile) == sizeof(header)) {
-		size_t hdr_packedsize, depackedsize;
+	blz4_cond_destroy(&pool->done_cond);
+	blz4_cond_destroy(&pool->work_cond);
+	blz4_mutex_destroy(&pool->mutex);
 
-		/* Show a little progress indicator */
-		if (be_verbose) {
-			fprintf(stderr, "%c\r", rotator[counter]);
-			counter = (counter + 1) & 0x03;
-		}
+	free(pool->done);
+	free(pool->workers);
+}
 
-		/* Get compressed size from header */
-		hdr_packedsize = (size_t) read_le32(header);
+/*
+ * Number of buckets in histograms of sequences. Bucket 0 holds the value
+ * 0, and bucket i > 0 holds values from 2^(i - 1) to 2^i - 1.
+ */
+#define SEQ_BUCKETS 32
 
-		/* If header is LZ4 magic value, assume new frame */
-		if (hdr_packedsize == LZ4_LEGACY_MAGIC) {
-			insize += sizeof(header);
-			continue;
-		}
+/*
+ * Statistics of the sequences in compressed blocks.
+ */
+struct seq_stats {
+	unsigned long long blocks;
+	unsigned long long stored_blocks;    /* Blocks stored uncompressed */
+	unsigned long long size;             /* Decompressed size */
+	unsigned long long packed_size;      /* Compressed size */
+	unsigned long long sequences;        /* Tokens, including last literals */
+	unsigned long long literal_bytes;
+	unsigned long long match_bytes;
+	unsigned long long literal_ext_bytes; /* Bytes extending literal lengths */
+	unsigned long long match_ext_bytes;   /* Bytes extending match lengths */
+	unsigned long long literal_runs[SEQ_BUCKETS];
+	unsigned long long match_lengths[SEQ_BUCKETS];
+	unsigned long long offsets[SEQ_BUCKETS];
+};
 
-		/* Check buffer is sufficient */
-		if (hdr_packedsize > max_packed_size) {
-			printf_error("compressed size in header too large");
-			goto out;
+/*
+ * Sequence statistics output for --stats, for each block and in total.
+ */
+struct seq_report {
+	FILE *out;
+	int json;
+	struct seq_stats total;
+};
+
+static int
+seq_bucket(unsigned long value)
+{
+	int bucket = 0;
+
+	while (value > 0 && bucket < SEQ_BUCKETS - 1) {
+		value >>= 1;
+		++bucket;
+	}
+
+	return bucket;
+}
+
+/*
+ * Walk the sequences of compressed block `packed`, adding them to `st`.
+ *
+ * Returns 0 on success, -1 if the block is malformed.
+ */
+static int
+seq_scan(const byte *packed, unsigned long packed_size, struct seq_stats *st)
+{
+	const byte *p = packed;
+	const byte *end = packed + packed_size;
+
+	while (p < end) {
+		const unsigned long token = *p++;
+		unsigned long nlit = token >> 4;
+		unsigned long len = (token & 0x0F) + 4;
+		unsigned long offs;
+
+		/* Literal run, with length extension bytes */
+		if (nlit == 15) {
+			unsigned long b;
+
+			do {
+				if (p == end) {
+					return -1;
+				}
+				b = *p++;
+				nlit += b;
+				++st->literal_ext_bytes;
+			} while (b == 255);
 		}
 
-		/* Read compressed data */
-		if (fread(packed, 1, hdr_packedsize, packedfile) != hdr_packedsize) {
-			printf_error("error reading block from compressed file");
-			goto out;
+		if ((unsigned long) (end - p) < nlit) {
+			return -1;
 		}
 
-		/* Decompress data */
-		depackedsize = lz4_depack(packed, data,
-		                          (unsigned long) hdr_packedsize);
+		p += nlit;
 
-		/* Check for decompression error */
-		if (depackedsize == LZ4_ERROR) {
-			printf_error("an error occured while decompressing");
-			goto out;
+		++st->sequences;
+		st->literal_bytes += nlit;
+		++st->literal_runs[seq_bucket(nlit)];
+
+		/* Last sequence has only literals */
+		if (p == end) {
+			break;
+		}
+
+		if (end - p < 2) {
+			return -1;
 		}
 
-		/* Write decompressed data */
-		fwrite(data, 1, depackedsize, newfile);
+		offs = (unsigned long) p[0] | ((unsigned long) p[1] << 8);
+		p += 2;
+
+		/* Match length, with length extension bytes */
+		if (len == 19) {
+			unsigned long b;
+
+			do {
+				if (p == end) {
+					return -1;
+				}
+				b = *p++;
+				len += b;
+				++st->match_ext_bytes;
+			} while (b == 255);
+		}
 
-		/* Sum input and output size */
-		insize += hdr_packedsize + sizeof(header);
-		outsize += depackedsize;
+		st->match_bytes += len;
+		++st->match_lengths[seq_bucket(len)];
+		++st->offsets[seq_bucket(offs)];
 	}
 
-	clocks = clock() - clocks;
+	return 0;
+}
 
-	/* Show result */
-	if (be_verbose) {
-		fprintf(stderr, "in %lld out %lld ratio %u%% time %.2f\n",
-		        insize, outsize, ratio(insize, outsize),
-		        (double) clocks / (double) CLOCKS_PER_SEC);
+static void
+seq_stats_add(struct seq_stats *sum, const struct seq_stats *st)
+{
+	int i;
+
+	sum->blocks += st->blocks;
+	sum->stored_blocks += st->stored_blocks;
+	sum->size += st->size;
+	sum->packed_size += st->packed_size;
+	sum->sequences += st->sequences;
+	sum->literal_bytes += st->literal_bytes;
+	sum->match_bytes += st->match_bytes;
+	sum->literal_ext_bytes += st->literal_ext_bytes;
+	sum->match_ext_bytes += st->match_ext_bytes;
+
+	for (i = 0; i < SEQ_BUCKETS; ++i) {
+		sum->literal_runs[i] += st->literal_runs[i];
+		sum->match_lengths[i] += st->match_lengths[i];
+		sum->offsets[i] += st->offsets[i];
 	}
+}
 
-	res = 0;
+/*
+ * Get fraction of decompressed bytes that are literals, where stored
+ * blocks count as literals.
+ */
+static double
+seq_literal_fraction(const struct seq_stats *st)
+{
+	return st->size > 0 ? (double) (st->size - st->match_bytes) / (double) st->size : 0.0;
+}
 
-out:
-	/* Close files */
-	if (packedfile != NULL) {
-		fclose(packedfile);
-	}
-	if (newfile != NULL) {
-		fclose(newfile);
-	}
+static void
+seq_print_histogram_json(FILE *out, const char *name,
+                         const unsigned long long *hist, int last)
+{
+	int num_buckets = SEQ_BUCKETS;
+	int i;
 
-	/* Free memory */
-	if (packed != NULL) {
-		free(packed);
+	/* Leave out empty buckets at the end */
+	while (num_buckets > 0 && hist[num_buckets - 1] == 0) {
+		--num_buckets;
 	}
-	if (data != NULL) {
-		free(data);
+
+	fprintf(out, "\"%s\": [", name);
+
+	for (i = 0; i < num_buckets; ++i) {
+		fprintf(out, "%s%llu", i > 0 ? ", " : "", hist[i]);
 	}
 
-	return res;
+	fprintf(out, "]%s", last ? "" : ", ");
 }
 
 static void
-print_syntax(void)
+seq_print_json(FILE *out, const struct seq_stats *st)
 {
-	fputs("usage: blz4 [options] INFILE OUTFILE\n"
-	      "\n"
-	      "options:\n"
-	      "  -5                     compress faster (default)\n"
-	      "  -9                     compress better\n"
-	      "      --optimal          optimal but very slow compression\n"
-	      "  -d, --decompress       decompress\n"
-	      "  -h, --help             print this help and exit\n"
-	      "  -v, --verbose          verbose mode\n"
-	      "  -V, --version          print version and exit\n"
-	      "\n"
-	      "PLEASE NOTE: This is an experiment, use at your own risk.\n", stdout);
+	fprintf(out, "{ \"size\": %llu, \"packed_size\": %llu, \"blocks\": %llu, "
+	        "\"stored_blocks\": %llu, \"sequences\": %llu, "
+	        "\"literal_bytes\": %llu, \"match_bytes\": %llu, "
+	        "\"literal_fraction\": %.4f, \"literal_ext_bytes\": %llu, "
+	        "\"match_ext_bytes\": %llu, ",
+	        st->size, st->packed_size, st->blocks, st->stored_blocks,
+	        st->sequences, st->literal_bytes, st->match_bytes,
+	        seq_literal_fraction(st), st->literal_ext_bytes,
+	        st->match_ext_bytes);
+
+	seq_print_histogram_json(out, "literal_runs", st->literal_runs, 0);
+	seq_print_histogram_json(out, "match_lengths", st->match_lengths, 0);
+	seq_print_histogram_json(out, "offsets", st->offsets, 1);
+
+	fputs(" }", out);
 }
 
 static void
-print_version(void)
+seq_print_text(FILE *out, const char *name, const struct seq_stats *st)
 {
-	fputs("blz4 " LZ4_VER_STRING "\n"
-	      "\n"
-	      "Copyright (c) 2018-2020 Joergen Ibsen\n"
-	      "\n"
-	      "Licensed under the zlib license (Zlib).\n"
-	      "There is NO WARRANTY, to the extent permitted by law.\n", stdout);
+	fprintf(out, "%s: %llu -> %llu, %llu sequences, %.1f%% literals, "
+	        "%llu literal and %llu match length extension bytes%s\n",
+	        name, st->size, st->packed_size, st->sequences,
+	        100.0 * seq_literal_fraction(st), st->literal_ext_bytes,
+	        st->match_ext_bytes, st->blocks > 0 && st->stored_blocks == st->blocks ? ", stored" : "");
 }
 
-int
-main(int argc, char *argv[])
+static void
+seq_report_begin(struct seq_report *report, FILE *out, int json)
 {
-	struct parg_state ps;
-	const char *infile = NULL;
-	const char *outfile = NULL;
-	int flag_decompress = 0;
-	int flag_verbose = 0;
-	int level = 5;
-	int c;
+	memset(report, 0, sizeof(*report));
 
-	const struct parg_option long_options[] = {
-		{ "decompress", PARG_NOARG, NULL, 'd' },
-		{ "help", PARG_NOARG, NULL, 'h' },
-		{ "optimal", PARG_NOARG, NULL, 'x' },
+	report->out = out;
+	report->json = json;
+
+	if (json) {
+		fputs("{\n  \"blocks\": [", out);
+	}
+}
+
+/*
+ * Add block to report, where `stored` blocks are uncompressed.
+ *
+ * Returns 0 on success, -1 if the block is malformed.
+ */
+static int
+seq_report_block(struct seq_report *report, const byte *packed,
+                 unsigned long packed_size, unsigned long size, int stored)
+{
+	struct seq_stats st;
+
+	memset(&st, 0, sizeof(st));
+
+	st.blocks = 1;
+	st.stored_blocks = stored ? 1 : 0;
+	st.size = size;
+	st.packed_size = packed_size;
+
+	if (!stored && seq_scan(packed, packed_size, &st) != 0) {
+		return -1;
+	}
+
+	if (report->json) {
+		fputs(report->total.blocks > 0 ? ",\n    " : "\n    ", report->out);
+		seq_print_json(report->out, &st);
+	}
+	else {
+		char name[32];
+
+		sprintf(name, "block %llu", report->total.blocks);
+		seq_print_text(report->out, name, &st);
+	}
+
+	seq_stats_add(&report->total, &st);
+
+	return 0;
+}
+
+static void
+seq_report_end(struct seq_report *report)
+{
+	const struct seq_stats *st = &report->total;
+	FILE *out = report->out;
+	int num_buckets = 1;
+	int i;
+
+	if (report->json) {
+		fputs("\n  ],\n  \"total\": ", out);
+		seq_print_json(out, st);
+		fputs("\n}\n", out);
+		return;
+	}
+
+	seq_print_text(out, "total", st);
+
+	for (i = 0; i < SEQ_BUCKETS; ++i) {
+		if (st->literal_runs[i] || st->match_lengths[i] || st->offsets[i]) {
+			num_buckets = i + 1;
+		}
+	}
+
+	fprintf(out, "\n%-15s %14s %14s %14s\n", "range", "literal runs",
+	        "match lengths", "offsets");
+
+	for (i = 0; i < num_buckets; ++i) {
+		char range[32];
+
+		if (i <= 1) {
+			sprintf(range, "%d", i);
+		}
+		else {
+			sprintf(range, "%lu-%lu", 1UL << (i - 1), (1UL << i) - 1);
+		}
+
+		fprintf(out, "%-15s %14llu %14llu %14llu\n", range, st->literal_runs[i],
+		        st->match_lengths[i], st->offsets[i]);
+	}
+}
+
+/*
+ * Block of input to compress, and the result.
+ */
+struct compress_job {
+	byte *data;               /* Dictionary followed by input block */
+	byte *packed;             /* Compressed block */
+	unsigned long dict_size;  /* Size of dictionary in data */
+	unsigned long size;       /* Size of input block */
+	unsigned long packedsize; /* Size of compressed block */
+	const struct lz4_params *params;
+	int gather_stats;         /* Gather statistics in stats */
+	struct lz4_pack_stats stats;
+};
+
+static void
+compress_job(void *ctx, size_t index, void *workmem)
+{
+	struct compress_job *job = &((struct compress_job *) ctx)[index];
+	struct lz4_pack_stats *stats = NULL;
+
+	if (job->gather_stats) {
+		memset(&job->stats, 0, sizeof(job->stats));
+		stats = &job->stats;
+	}
+
+	if (job->dict_size > 0) {
+		job->packedsize = lz4_pack_params_dict_stats(job->data + job->dict_size,
+		                                             job->packed, job->size,
+		                                             job->data, job->dict_size,
+		                                             workmem, job->params, stats);
+	}
+	else {
+		job->packedsize = lz4_pack_params_stats(job->data, job->packed, job->size,
+		                                        workmem, job->params, stats);
+	}
+}
+
+static void
+add_pack_stats(struct lz4_pack_stats *sum, const struct lz4_pack_stats *stats)
+{
+	sum->time_build += stats->time_build;
+	sum->time_search += stats->time_search;
+	sum->time_parse += stats->time_parse;
+	sum->time_emit += stats->time_emit;
+	sum->nodes_visited += stats->nodes_visited;
+	sum->bytes_compared += stats->bytes_compared;
+	sum->accept_cutoffs += stats->accept_cutoffs;
+}
+
+/*
+ * Show statistics of parsers that gather them, with times summed over
+ * threads.
+ */
+static void
+print_pack_stats(const struct lz4_pack_stats *stats, int parser)
+{
+	if (parser != LZ4_PARSER_LEPARSE && parser != LZ4_PARSER_BTPARSE) {
+		return;
+	}
+
+	fprintf(stderr, "time build %.2f search %.2f parse %.2f emit %.2f\n",
+	        stats->time_build, stats->time_search, stats->time_parse,
+	        stats->time_emit);
+	fprintf(stderr, "nodes visited %llu bytes compared %llu accept cutoffs %llu\n",
+	        stats->nodes_visited, stats->bytes_compared, stats->accept_cutoffs);
+}
+
+/*
+ * Append entry for block at decompressed offset `offs` and file offset
+ * `file_offs` to seek index, returning 0 on success.
+ */
+static int
+add_index_entry(byte **index, size_t *index_size, size_t *index_capacity,
+                unsigned long long offs, unsigned long long file_offs)
+{
+	if (*index_size + LZ4_INDEX_ENTRY_SIZE > *index_capacity) {
+		size_t capacity = *index_capacity > 0 ? 2 * *index_capacity : 64 * LZ4_INDEX_ENTRY_SIZE;
+		byte *p = (byte *) realloc(*index, capacity);
+
+		if (p == NULL) {
+			return -1;
+		}
+
+		*index = p;
+		*index_capacity = capacity;
+	}
+
+	write_le32(*index + *index_size, (unsigned long) (offs & 0xFFFFFFFFUL));
+	write_le32(*index + *index_size + 4, (unsigned long) (offs >> 32));
+	write_le32(*index + *index_size + 8, (unsigned long) (file_offs & 0xFFFFFFFFUL));
+	write_le32(*index + *index_size + 12, (unsigned long) (file_offs >> 32));
+
+	*index_size += LZ4_INDEX_ENTRY_SIZE;
+
+	return 0;
+}
+
+/*
+ * Write seek index in a skippable frame, returning number of bytes written.
+ */
+static size_t
+write_index(FILE *packedfile, const byte *index, size_t index_size,
+            unsigned long long content_size, unsigned long block_size,
+            const struct frame_options *frame)
+{
+	byte header[8];
+	byte trailer[LZ4_INDEX_TRAILER_SIZE];
+	unsigned long flags = 0;
+
+	if (frame != NULL) {
+		flags |= LZ4_INDEX_FRAME_BLOCKS;
+
+		if (frame->block_checksum) {
+			flags |= LZ4_INDEX_BLOCK_CHECKSUM;
+		}
+	}
+
+	write_le32(header, LZ4_INDEX_MAGIC);
+	write_le32(header + 4, (unsigned long) (index_size + LZ4_INDEX_TRAILER_SIZE));
+
+	write_le32(trailer, (unsigned long) (content_size & 0xFFFFFFFFUL));
+	write_le32(trailer + 4, (unsigned long) (content_size >> 32));
+	write_le32(trailer + 8, (unsigned long) (index_size / LZ4_INDEX_ENTRY_SIZE));
+	write_le32(trailer + 12, block_size);
+	write_le32(trailer + 16, flags);
+	write_le32(trailer + 20, LZ4_INDEX_ID);
+
+	fwrite(header, 1, sizeof(header), packedfile);
+	fwrite(index, 1, index_size, packedfile);
+	fwrite(trailer, 1, sizeof(trailer), packedfile);
+
+	return sizeof(header) + index_size + sizeof(trailer);
+}
+
+/*
+ * Compress file, using a pool of `num_threads` threads each with its own
+ * workmem. With linked blocks, each job carries its own copy of the
+ * dictionary.
+ *
+ * If `seek_index` is set, the offset of each block is recorded and
+ * written in a seek index at the end.
+ */
+static int
+compress_file(const char *oldname, const char *packedname, int be_verbose,
+              const struct lz4_params *params, const struct frame_options *frame,
+              int num_threads, int seek_index, struct seq_report *report)
+{
+	const byte lz4_magic[4] = { 0x02, 0x21, 0x4C, 0x18 };
+	byte header[LZ4_FRAME_HEADER_MAX];
+	FILE *oldfile = NULL;
+	FILE *packedfile = NULL;
+	struct job_pool pool;
+	struct compress_job *jobs = NULL;
+	byte *history = NULL;
+	byte *index = NULL;
+	size_t index_size = 0, index_capacity = 0;
+	long long insize = 0, outsize = 0;
+	long long written_insize = 0;
+	long long content_size = 0;
+	long long file_size;
+	struct lz4_xxh32_state content_xxh;
+	struct lz4_pack_stats stats;
+	unsigned long block_size = BLOCK_SIZE;
+	unsigned long buf_size;
+	unsigned long dict_max = 0;
+	unsigned long history_size = 0;
+	unsigned long num_written = 0;
+	size_t workmem_size;
+	size_t i;
+	double secs;
+	int eof = 0;
+	int res = 1;
+
+	if (frame != NULL) {
+		block_size = frame_block_size(frame->block_size_id);
+
+		/* Linked blocks use the previous 64 KiB as dictionary */
+		if (frame->linked) {
+			dict_max = LZ4_DICT_SIZE_MAX;
+		}
+	}
+
+	buf_size = block_size;
+
+	/* Open input file */
+	if ((oldfile = fopen(oldname, "rb")) == NULL) {
+		printf_usage("unable to open input file '%s'", oldname);
+		return 1;
+	}
+
+	/* Get size of input file, if possible */
+	if (_fseeki64(oldfile, 0, SEEK_END) != 0
+	 || (file_size = (long long) _ftelli64(oldfile)) < 0
+	 || _fseeki64(oldfile, 0, SEEK_SET) != 0) {
+		file_size = -1;
+		rewind(oldfile);
+	}
+
+	/*
+	 * Size buffers and workmem for the input if it is smaller than a
+	 * block, and do not start more threads than there are blocks.
+	 */
+	if (file_size >= 0) {
+		const long long num_blocks = file_size / (long long) block_size + 1;
+
+		if (file_size < (long long) block_size) {
+			buf_size = file_size > 0 ? (unsigned long) file_size : 1;
+		}
+
+		if (num_threads > num_blocks) {
+			num_threads = (int) num_blocks;
+		}
+	}
+
+	workmem_size = dict_max > 0
+	             ? lz4_workmem_size_params_dict(buf_size, params)
+	             : lz4_workmem_size_params(buf_size, params);
+
+	/* Allocate memory */
+	if (job_pool_init(&pool, num_threads, compress_job, NULL) != 0
+	 || (jobs = (struct compress_job *) calloc(pool.num_jobs, sizeof(jobs[0]))) == NULL
+	 || (dict_max > 0 && (history = (byte *) malloc(dict_max)) == NULL)) {
+		printf_error("not enough memory");
+		goto out;
+	}
+
+	pool.ctx = jobs;
+
+	memset(&stats, 0, sizeof(stats));
+
+	for (i = 0; i < pool.num_jobs; ++i) {
+		jobs[i].params = params;
+		jobs[i].gather_stats = be_verbose;
+
+		if ((jobs[i].data = (byte *) malloc(dict_max + buf_size)) == NULL
+		 || (jobs[i].packed = (byte *) malloc(lz4_max_packed_size(buf_size))) == NULL) {
+			printf_error("not enough memory");
+			goto out;
+		}
+	}
+
+	for (i = 0; i < pool.num_workers; ++i) {
+		if ((pool.workers[i].data = malloc(workmem_size)) == NULL) {
+			printf_error("not enough memory");
+			goto out;
+		}
+	}
+
+	/* Get size of input file if it is stored in the frame header */
+	if (frame != NULL && frame->content_size) {
+		if (file_size < 0) {
+			printf_error("unable to get size of input file '%s'", oldname);
+			goto out;
+		}
+
+		content_size = file_size;
+	}
+
+	/* Create output file */
+	if ((packedfile = fopen(packedname, "wb")) == NULL) {
+		printf_usage("unable to open output file '%s'", packedname);
+		goto out;
+	}
+
+	if (job_pool_start(&pool) != 0) {
+		goto out;
+	}
+
+	secs = get_time();
+
+	if (frame != NULL) {
+		/* Write LZ4 frame header */
+		size_t header_size = write_frame_header(header, frame, content_size);
+
+		fwrite(header, 1, header_size, packedfile);
+		outsize += header_size;
+
+		lz4_xxh32_init(&content_xxh, 0);
+	}
+	else {
+		/* Write LZ4 header magic */
+		fwrite(lz4_magic, 1, sizeof(lz4_magic), packedfile);
+		outsize += sizeof(lz4_magic);
+	}
+
+	for (;;) {
+		struct compress_job *job;
+		const byte *block;
+		unsigned long block_header;
+		unsigned long packedsize;
+
+		/* Read input into free jobs and hand them out */
+		while (!eof && pool.num_submitted - num_written < pool.num_jobs) {
+			size_t n_read;
+
+			job = &jobs[job_pool_next(&pool)];
+
+			/* Copy dictionary for linked blocks */
+			if (history_size > 0) {
+				memcpy(job->data, history, history_size);
+			}
+			job->dict_size = history_size;
+
+			n_read = fread(job->data + job->dict_size, 1, buf_size, oldfile);
+
+			if (n_read == 0) {
+				eof = 1;
+				break;
+			}
+
+			job->size = (unsigned long) n_read;
+
+			if (frame != NULL && frame->content_checksum) {
+				lz4_xxh32_update(&content_xxh, job->data + job->dict_size, n_read);
+			}
+
+			/* Keep the last dict_max bytes as dictionary for next block */
+			if (dict_max > 0) {
+				unsigned long keep = job->dict_size + job->size;
+
+				if (keep > dict_max) {
+					keep = dict_max;
+				}
+
+				memcpy(history, job->data + job->dict_size + job->size - keep, keep);
+				history_size = keep;
+			}
+
+			/* Sum input size */
+			insize += n_read;
+
+			job_pool_submit(&pool);
+		}
+
+		if (num_written == pool.num_submitted) {
+			break;
+		}
+
+		/* Wait for next block in order to be compressed */
+		job = &jobs[job_pool_wait(&pool, num_written)];
+
+		/* Show a little progress indicator */
+		if (be_verbose) {
+			show_progress();
+			add_pack_stats(&stats, &job->stats);
+		}
+
+		packedsize = job->packedsize;
+
+		/* Check for compression error */
+		if (packedsize == 0 || packedsize == LZ4_ERROR) {
+			printf_error("an error occured while compressing");
+			goto out;
+		}
+
+		/* Put block-specific values into header */
+		block = job->packed;
+		block_header = packedsize;
+
+		/* Store block uncompressed in frame if it did not shrink */
+		if (frame != NULL && packedsize >= job->size) {
+			block = job->data + job->dict_size;
+			packedsize = job->size;
+			block_header = packedsize | LZ4_FRAME_BLOCK_UNCOMPRESSED;
+		}
+
+		/* Add sequences of block to report */
+		if (report != NULL
+		 && seq_report_block(report, block, packedsize, job->size,
+		                     block != job->packed) != 0) {
+			printf_error("malformed compressed block");
+			goto out;
+		}
+
+		/* Record offsets of block in seek index */
+		if (seek_index) {
+			if (add_index_entry(&index, &index_size, &index_capacity,
+			                    (unsigned long long) written_insize,
+			                    (unsigned long long) outsize) != 0) {
+				printf_error("not enough memory");
+				goto out;
+			}
+
+			written_insize += job->size;
+		}
+
+		write_le32(header, block_header);
+
+		/* Write header and compressed data */
+		fwrite(header, 1, 4, packedfile);
+		fwrite(block, 1, packedsize, packedfile);
+		outsize += packedsize + 4;
+
+		/* Write block checksum */
+		if (frame != NULL && frame->block_checksum) {
+			write_le32(header, lz4_xxh32(block, packedsize, 0));
+			fwrite(header, 1, 4, packedfile);
+			outsize += 4;
+		}
+
+		++num_written;
+	}
+
+	if (frame != NULL) {
+		/* Write end mark */
+		write_le32(header, 0);
+		fwrite(header, 1, 4, packedfile);
+		outsize += 4;
+
+		/* Write content checksum */
+		if (frame->content_checksum) {
+			write_le32(header, lz4_xxh32_digest(&content_xxh));
+			fwrite(header, 1, 4, packedfile);
+			outsize += 4;
+		}
+	}
+
+	if (seek_index) {
+		outsize += write_index(packedfile, index, index_size,
+		                       (unsigned long long) insize, block_size, frame);
+	}
+
+	secs = get_time() - secs;
+
+	/* Show result */
+	if (be_verbose) {
+		fprintf(stderr, "in %lld out %lld ratio %u%% time %.2f (%.1f MB/s)\n",
+		        insize, outsize, ratio(outsize, insize),
+		        secs, mb_per_sec(insize, secs));
+		print_pack_stats(&stats, params->parser);
+	}
+
+	res = 0;
+
+out:
+	/* Close files */
+	if (packedfile != NULL) {
+		fclose(packedfile);
+	}
+	if (oldfile != NULL) {
+		fclose(oldfile);
+	}
+
+	/* Stop threads and free memory */
+	job_pool_free(&pool);
+
+	if (jobs != NULL) {
+		for (i = 0; i < pool.num_jobs; ++i) {
+			free(jobs[i].packed);
+			free(jobs[i].data);
+		}
+		free(jobs);
+	}
+	if (history != NULL) {
+		free(history);
+	}
+	free(index);
+
+	return res;
+}
+
+/*
+ * Block to decompress, and the result.
+ */
+struct depack_job {
+	byte *packed;               /* Compressed block */
+	byte *data;                 /* Dictionary followed by decompressed block */
+	unsigned long dict_size;    /* Size of dictionary in data */
+	unsigned long packedsize;   /* Size of compressed block */
+	unsigned long capacity;     /* Space for decompressed block */
+	unsigned long target;       /* Bytes wanted, less for partial */
+	unsigned long depackedsize; /* Size of decompressed block */
+	int stored;                 /* Block is stored uncompressed */
+};
+
+static void
+depack_job(void *ctx, size_t index, void *worker_data)
+{
+	struct depack_job *job = &((struct depack_job *) ctx)[index];
+	byte *out = job->data + job->dict_size;
+
+	(void) worker_data;
+
+	if (job->stored) {
+		memcpy(out, job->packed, job->packedsize);
+		job->depackedsize = job->packedsize;
+	}
+	else if (job->dict_size > 0) {
+		job->depackedsize = lz4_depack_safe_dict(job->packed, out, job->packedsize,
+		                                         job->capacity, job->data, job->dict_size);
+	}
+	else if (job->target < job->capacity) {
+		job->depackedsize = lz4_depack_partial(job->packed, out, job->packedsize,
+		                                       job->target);
+	}
+	else {
+		job->depackedsize = lz4_depack_safe(job->packed, out, job->packedsize,
+		                                    job->capacity);
+	}
+}
+
+/*
+ * Format of the blocks being decompressed, and totals.
+ */
+struct depack_state {
+	FILE *packedfile;
+	FILE *newfile;
+	long long insize;
+	long long outsize;
+	unsigned long block_max;   /* Maximum size of decompressed block */
+	unsigned long packed_max;  /* Maximum size of compressed block */
+	int frame;                 /* Blocks are in an LZ4 frame */
+	int linked;                /* Blocks may refer to previous blocks */
+	int block_checksum;        /* Blocks are followed by checksum */
+	int content_checksum;      /* Compute checksum of decompressed data */
+	struct lz4_xxh32_state content_xxh;
+	unsigned long long frame_outsize;
+	unsigned long magic;       /* Magic read after legacy blocks, or 0 */
+	long long limit;           /* Bytes left to output, or -1 for all */
+	int be_verbose;
+	struct seq_report *report; /* Report of sequences, or NULL */
+};
+
+/*
+ * Read next legacy block into job.
+ *
+ * Returns 1 if a block was read, 0 at end of file or if the magic of
+ * another frame type was read into `state->magic`, and -1 on error.
+ */
+static int
+read_legacy_block(struct depack_state *state, struct depack_job *job)
+{
+	byte header[4];
+	size_t hdr_packedsize;
+
+	for (;;) {
+		if (fread(header, 1, sizeof(header), state->packedfile) != sizeof(header)) {
+			return 0;
+		}
+
+		/* Get compressed size from header */
+		hdr_packedsize = (size_t) read_le32(header);
+
+		/* If header is LZ4 magic value, assume new frame */
+		if (hdr_packedsize == LZ4_LEGACY_MAGIC) {
+			state->insize += sizeof(header);
+			continue;
+		}
+
+		/* If header is magic of another frame type, return it */
+		if (hdr_packedsize == LZ4_FRAME_MAGIC
+		 || (hdr_packedsize & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC) {
+			state->magic = (unsigned long) hdr_packedsize;
+			return 0;
+		}
+
+		break;
+	}
+
+	/* Check buffer is sufficient */
+	if (hdr_packedsize > state->packed_max) {
+		printf_error("compressed size in header too large");
+		return -1;
+	}
+
+	/* Read compressed data */
+	if (fread(job->packed, 1, hdr_packedsize, state->packedfile) != hdr_packedsize) {
+		printf_error("error reading block from compressed file");
+		return -1;
+	}
+
+	job->packedsize = (unsigned long) hdr_packedsize;
+	job->stored = 0;
+
+	state->insize += hdr_packedsize + sizeof(header);
+
+	return 1;
+}
+
+/*
+ * Read next block of LZ4 frame into job.
+ *
+ * Returns 1 if a block was read, 0 at the end mark, and -1 on error.
+ */
+static int
+read_frame_block(struct depack_state *state, struct depack_job *job)
+{
+	byte header[4];
+	unsigned long block_header, size;
+
+	if (fread(header, 1, 4, state->packedfile) != 4) {
+		printf_error("unexpected end of LZ4 frame");
+		return -1;
+	}
+
+	state->insize += 4;
+
+	block_header = read_le32(header);
+
+	/* Check for end mark */
+	if (block_header == 0) {
+		return 0;
+	}
+
+	size = block_header & ~LZ4_FRAME_BLOCK_UNCOMPRESSED;
+
+	if (size > state->packed_max) {
+		printf_error("block size in LZ4 frame too large");
+		return -1;
+	}
+
+	/* Read block data */
+	if (fread(job->packed, 1, size, state->packedfile) != size) {
+		printf_error("error reading block from compressed file");
+		return -1;
+	}
+
+	state->insize += size;
+
+	/* Check block checksum */
+	if (state->block_checksum) {
+		if (fread(header, 1, 4, state->packedfile) != 4) {
+			printf_error("unexpected end of LZ4 frame");
+			return -1;
+		}
+
+		state->insize += 4;
+
+		if (read_le32(header) != lz4_xxh32(job->packed, size, 0)) {
+			printf_error("block checksum mismatch");
+			return -1;
+		}
+	}
+
+	job->packedsize = size;
+	job->stored = (block_header & LZ4_FRAME_BLOCK_UNCOMPRESSED) != 0;
+
+	return 1;
+}
+
+/*
+ * Decompress blocks using a pool of `num_threads` threads.
+ *
+ * The main thread reads blocks, which only requires the size in the block
+ * headers, hands them to the threads which decompress them into buffers
+ * of their own, and writes them in order. Linked blocks depend on the
+ * previous block, so they are decompressed on the main thread.
+ *
+ * If there is a limit on the output, blocks are decompressed on the main
+ * thread, and only as much of each as needed.
+ *
+ * Returns 0 on success, 1 if the limit was reached, and -1 on error.
+ */
+static int
+depack_blocks(struct depack_state *state, int num_threads)
+{
+	struct job_pool pool;
+	struct depack_job *jobs = NULL;
+	const unsigned long dict_max = state->linked ? LZ4_DICT_SIZE_MAX : 0;
+	unsigned long history_size = 0;
+	unsigned long num_written = 0;
+	size_t i;
+	int eof = 0;
+	int res = -1;
+
+	if (state->linked || state->limit >= 0) {
+		num_threads = 1;
+	}
+
+	/* Allocate memory */
+	if (job_pool_init(&pool, num_threads, depack_job, NULL) != 0
+	 || (jobs = (struct depack_job *) calloc(pool.num_jobs, sizeof(jobs[0]))) == NULL) {
+		printf_error("not enough memory");
+		goto out;
+	}
+
+	pool.ctx = jobs;
+
+	for (i = 0; i < pool.num_jobs; ++i) {
+		jobs[i].capacity = state->block_max;
+
+		if ((jobs[i].packed = (byte *) malloc(state->packed_max)) == NULL
+		 || (jobs[i].data = (byte *) malloc(dict_max + state->block_max)) == NULL) {
+			printf_error("not enough memory");
+			goto out;
+		}
+	}
+
+	if (job_pool_start(&pool) != 0) {
+		goto out;
+	}
+
+	for (;;) {
+		struct depack_job *job;
+		unsigned long size;
+		byte *out;
+
+		/* Read blocks into free jobs and hand them out */
+		while (!eof && pool.num_submitted - num_written < pool.num_jobs) {
+			int status;
+
+			job = &jobs[job_pool_next(&pool)];
+
+			status = state->frame ? read_frame_block(state, job)
+			       : read_legacy_block(state, job);
+
+			if (status < 0) {
+				goto out;
+			}
+
+			if (status == 0) {
+				eof = 1;
+				break;
+			}
+
+			job->dict_size = history_size;
+			job->target = state->limit >= 0 && state->limit < (long long) state->block_max
+			            ? (unsigned long) state->limit : state->block_max;
+
+			job_pool_submit(&pool);
+		}
+
+		if (num_written == pool.num_submitted) {
+			break;
+		}
+
+		/* Wait for next block in order to be decompressed */
+		job = &jobs[job_pool_wait(&pool, num_written)];
+
+		/* Show a little progress indicator */
+		if (state->be_verbose) {
+			show_progress();
+		}
+
+		/* Check for decompression error */
+		if (job->depackedsize == LZ4_ERROR) {
+			printf_error("an error occured while decompressing");
+			goto out;
+		}
+
+		out = job->data + job->dict_size;
+
+		/* Add sequences of block to report */
+		if (state->report != NULL
+		 && seq_report_block(state->report, job->packed, job->packedsize,
+		                     job->depackedsize, job->stored) != 0) {
+			printf_error("malformed compressed block");
+			goto out;
+		}
+
+		/* Write decompressed data, up to limit */
+		size = job->depackedsize;
+
+		if (state->limit >= 0 && (long long) size > state->limit) {
+			size = (unsigned long) state->limit;
+		}
+
+		fwrite(out, 1, size, state->newfile);
+
+		if (state->content_checksum) {
+			lz4_xxh32_update(&state->content_xxh, out, size);
+		}
+
+		/* Keep the last dict_max bytes as dictionary for next block */
+		if (dict_max > 0) {
+			unsigned long keep = job->dict_size + job->depackedsize;
+
+			if (keep > dict_max) {
+				keep = dict_max;
+			}
+
+			memmove(job->data, out + job->depackedsize - keep, keep);
+			history_size = keep;
+		}
+
+		/* Sum output size */
+		state->frame_outsize += size;
+		state->outsize += size;
+
+		/* Stop when limit is reached */
+		if (state->limit >= 0 && (state->limit -= size) == 0) {
+			res = 1;
+			goto out;
+		}
+
+		++num_written;
+	}
+
+	res = 0;
+
+out:
+	/* Stop threads and free memory */
+	job_pool_free(&pool);
+
+	if (jobs != NULL) {
+		for (i = 0; i < pool.num_jobs; ++i) {
+			free(jobs[i].data);
+			free(jobs[i].packed);
+		}
+		free(jobs);
+	}
+
+	return res;
+}
+
+/*
+ * Decompress LZ4 frame following the frame magic.
+ *
+ * Returns 0 on success, 1 if the output limit was reached, and -1 on
+ * error.
+ */
+static int
+depack_frame(struct depack_state *state, int num_threads)
+{
+	byte header[LZ4_FRAME_HEADER_MAX];
+	unsigned long long content_size = 0;
+	size_t desc_size = 2;
+	int flg, bd;
+	int res;
+
+	/* Read FLG and BD bytes of frame descriptor */
+	if (fread(header, 1, 2, state->packedfile) != 2) {
+		printf_error("unable to read LZ4 frame descriptor");
+		return -1;
+	}
+
+	flg = header[0];
+	bd = header[1];
+
+	/* Check version and reserved bits */
+	if ((flg & 0xC0) != 0x40 || (flg & 0x02) != 0 || (bd & 0x8F) != 0
+	 || ((bd >> 4) & 0x07) < 4) {
+		printf_error("unsupported LZ4 frame descriptor");
+		return -1;
+	}
+
+	if (flg & 0x01) {
+		printf_error("LZ4 frame dictionary ID not supported");
+		return -1;
+	}
+
+	if (flg & 0x08) {
+		desc_size += 8;
+	}
+
+	/* Read rest of frame descriptor and header checksum */
+	if (fread(header + 2, 1, desc_size - 1, state->packedfile) != desc_size - 1) {
+		printf_error("unable to read LZ4 frame descriptor");
+		return -1;
+	}
+
+	if (header[desc_size] != octet(lz4_xxh32(header, desc_size, 0) >> 8)) {
+		printf_error("LZ4 frame header checksum mismatch");
+		return -1;
+	}
+
+	if (flg & 0x08) {
+		content_size = (unsigned long long) read_le32(header + 2)
+		             | ((unsigned long long) read_le32(header + 6) << 32);
+	}
+
+	state->insize += desc_size + 1;
+
+	state->block_max = frame_block_size((bd >> 4) & 0x07);
+	state->packed_max = state->block_max;
+	state->frame = 1;
+	state->linked = (flg & 0x20) == 0;
+	state->block_checksum = (flg & 0x10) != 0;
+	state->content_checksum = (flg & 0x04) != 0;
+	state->frame_outsize = 0;
+
+	lz4_xxh32_init(&state->content_xxh, 0);
+
+	res = depack_blocks(state, num_threads);
+
+	/* Return on error, or if limit reached before end of frame */
+	if (res != 0) {
+		return res;
+	}
+
+	/* Check content checksum */
+	if (state->content_checksum) {
+		if (fread(header, 1, 4, state->packedfile) != 4) {
+			printf_error("unexpected end of LZ4 frame");
+			return -1;
+		}
+
+		state->insize += 4;
+
+		if (read_le32(header) != lz4_xxh32_digest(&state->content_xxh)) {
+			printf_error("content checksum mismatch");
+			return -1;
+		}
+	}
+
+	/* Check content size */
+	if ((flg & 0x08) && state->frame_outsize != content_size) {
+		printf_error("content size mismatch");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Decompress `packedname` to `newname`, or to stdout if NULL.
+ *
+ * If `limit` is not negative, only the first `limit` bytes are output.
+ */
+static int
+decompress_file(const char *packedname, const char *newname, int be_verbose,
+                int num_threads, long long limit, struct seq_report *report)
+{
+	byte header[4];
+	struct depack_state state;
+	unsigned long magic;
+	double secs;
+	int status;
+	int res = 1;
+
+	memset(&state, 0, sizeof(state));
+
+	state.be_verbose = be_verbose;
+	state.limit = limit;
+	state.report = report;
+
+	/* Open input file */
+	if ((state.packedfile = fopen(packedname, "rb")) == NULL) {
+		printf_usage("unable to open input file '%s'", packedname);
+		goto out;
+	}
+
+	/* Create output file */
+	if (newname == NULL) {
+#if defined(_WIN32)
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		state.newfile = stdout;
+	}
+	else if ((state.newfile = fopen(newname, "wb")) == NULL) {
+		printf_usage("unable to open output file '%s'", newname);
+		goto out;
+	}
+
+	/* Nothing to output */
+	if (limit == 0) {
+		res = 0;
+		goto out;
+	}
+
+	secs = get_time();
+
+	/* Read LZ4 header magic */
+	if (fread(header, 1, sizeof(header), state.packedfile) != sizeof(header)) {
+		printf_error("unable to read LZ4 header magic");
+		goto out;
+	}
+
+	magic = read_le32(header);
+
+	/* Decompress frames until end of file */
+	for (;;) {
+		state.insize += sizeof(header);
+
+		if (magic == LZ4_LEGACY_MAGIC) {
+			state.block_max = BLOCK_SIZE;
+			state.packed_max = lz4_max_packed_size(BLOCK_SIZE);
+			state.frame = 0;
+			state.linked = 0;
+			state.block_checksum = 0;
+			state.content_checksum = 0;
+			state.magic = 0;
+
+			if ((status = depack_blocks(&state, num_threads)) < 0) {
+				goto out;
+			}
+
+			/* Legacy blocks continue until end of file or next frame */
+			if (status > 0 || state.magic == 0) {
+				break;
+			}
+
+			magic = state.magic;
+
+			continue;
+		}
+
+		if (magic == LZ4_FRAME_MAGIC) {
+			if ((status = depack_frame(&state, num_threads)) < 0) {
+				goto out;
+			}
+
+			if (status > 0) {
+				break;
+			}
+		}
+		else if ((magic & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC) {
+			unsigned long skip_size;
+
+			/* Skip user data in skippable frame */
+			if (fread(header, 1, sizeof(header), state.packedfile) != sizeof(header)
+			 || (skip_size = read_le32(header)) > LONG_MAX
+			 || fseek(state.packedfile, (long) skip_size, SEEK_CUR) != 0) {
+				printf_error("unable to skip skippable frame");
+				goto out;
+			}
+
+			state.insize += sizeof(header) + skip_size;
+		}
+		else {
+			printf_error("LZ4 header magic mismatch");
+			goto out;
+		}
+
+		/* Read magic of next frame, if any */
+		if (fread(header, 1, sizeof(header), state.packedfile) != sizeof(header)) {
+			break;
+		}
+
+		magic = read_le32(header);
+	}
+
+	secs = get_time() - secs;
+
+	/* Show result */
+	if (be_verbose) {
+		fprintf(stderr, "in %lld out %lld ratio %u%% time %.2f (%.1f MB/s)\n",
+		        state.insize, state.outsize, ratio(state.insize, state.outsize),
+		        secs, mb_per_sec(state.outsize, secs));
+	}
+
+	res = 0;
+
+out:
+	/* Close files */
+	if (state.packedfile != NULL) {
+		fclose(state.packedfile);
+	}
+	if (state.newfile != NULL && state.newfile != stdout) {
+		fclose(state.newfile);
+	}
+
+	return res;
+}
+
+/*
+ * Write decompressed bytes `begin` up to `end` of `packedname`, which
+ * must have a seek index, to `newname`, or to stdout if NULL.
+ */
+static int
+range_file(const char *packedname, const char *newname,
+           unsigned long long begin, unsigned long long end)
+{
+	struct lz4_reader *reader = NULL;
+	FILE *newfile = NULL;
+	byte *data = NULL;
+	int res = 1;
+
+	/* Open input file and read seek index */
+	/* Cache one block, so blocks split between reads are decompressed once */
+	if ((reader = lz4_reader_open(packedname, 1)) == NULL) {
+		printf_error("unable to open '%s', or it has no seek index", packedname);
+		goto out;
+	}
+
+	if ((data = (byte *) malloc(BLOCK_SIZE)) == NULL) {
+		printf_error("not enough memory");
+		goto out;
+	}
+
+	/* Create output file */
+	if (newname == NULL) {
+#if defined(_WIN32)
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		newfile = stdout;
+	}
+	else if ((newfile = fopen(newname, "wb")) == NULL) {
+		printf_usage("unable to open output file '%s'", newname);
+		goto out;
+	}
+
+	while (begin < end) {
+		unsigned long size = end - begin < BLOCK_SIZE ? (unsigned long) (end - begin) : BLOCK_SIZE;
+		unsigned long num_read = lz4_reader_read(reader, data, begin, size);
+
+		if (num_read == LZ4_ERROR) {
+			printf_error("an error occured while decompressing");
+			goto out;
+		}
+
+		/* Stop at end of data */
+		if (num_read == 0) {
+			break;
+		}
+
+		fwrite(data, 1, num_read, newfile);
+		begin += num_read;
+	}
+
+	res = 0;
+
+out:
+	if (newfile != NULL && newfile != stdout) {
+		fclose(newfile);
+	}
+
+	free(data);
+	lz4_reader_close(reader);
+
+	return res;
+}
+
+/*
+ * Get parameters of `level` for `parser`, replaced by any non-zero fields
+ * of `overrides`, returning 0 if they are valid.
+ */
+static int
+get_params(struct lz4_params *params, int parser, int level,
+           const struct lz4_params *overrides)
+{
+	if (lz4_params_level(params, parser, level) != 0) {
+		return -1;
+	}
+
+	if (overrides->hash_bits > 0) {
+		params->hash_bits = overrides->hash_bits;
+	}
+	if (overrides->max_depth > 0) {
+		params->max_depth = overrides->max_depth;
+	}
+	if (overrides->accept_len > 0) {
+		params->accept_len = overrides->accept_len;
+	}
+	if (overrides->window_size > 0) {
+		params->window_size = overrides->window_size;
+	}
+
+	return lz4_workmem_size_params(0, params) == (size_t) -1 ? -1 : 0;
+}
+
+/*
+ * Minimum time in seconds of each timed run in benchmark mode, which
+ * repeats compressing or decompressing the file until it is reached.
+ */
+#ifndef BENCH_MIN_TIME
+#  define BENCH_MIN_TIME (0.1)
+#endif
+
+static int
+compare_double(const void *a, const void *b)
+{
+	const double x = *(const double *) a;
+	const double y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Sort `speeds` and get best and median.
+ */
+static void
+best_and_median(double *speeds, int num_runs, double *best, double *median)
+{
+	qsort(speeds, (size_t) num_runs, sizeof(speeds[0]), compare_double);
+
+	*best = speeds[num_runs - 1];
+	*median = num_runs % 2 ? speeds[num_runs / 2]
+	        : (speeds[num_runs / 2 - 1] + speeds[num_runs / 2]) / 2.0;
+}
+
+/*
+ * Benchmark compressing and decompressing file `name` in memory at levels
+ * `first_level` to `last_level`.
+ *
+ * The file is split into blocks of BLOCK_SIZE, like the legacy format.
+ * Each level is run `num_runs` times, verifying that decompression gives
+ * the original data. Non-zero fields of `overrides` replace the parameters
+ * of each level.
+ */
+static int
+bench_file(const char *name, int parser, int first_level, int last_level,
+           const struct lz4_params *overrides, int num_runs)
+{
+	FILE *file = NULL;
+	byte *data = NULL;
+	byte *packed = NULL;
+	byte *depacked = NULL;
+	unsigned long *packed_sizes = NULL;
+	double *comp_speeds = NULL;
+	double *depack_speeds = NULL;
+	void *workmem = NULL;
+	size_t workmem_capacity = 0;
+	long long file_size;
+	unsigned long block_size, last_size, max_packed, num_blocks;
+	int level;
+	int res = 1;
+
+	/* Read file into memory */
+	if ((file = fopen(name, "rb")) == NULL) {
+		printf_usage("unable to open input file '%s'", name);
+		return 1;
+	}
+
+	if (_fseeki64(file, 0, SEEK_END) != 0
+	 || (file_size = (long long) _ftelli64(file)) < 0
+	 || _fseeki64(file, 0, SEEK_SET) != 0) {
+		printf_error("unable to get size of input file '%s'", name);
+		goto out;
+	}
+
+	if (file_size == 0) {
+		printf_error("skipping empty file '%s'", name);
+		res = 0;
+		goto out;
+	}
+
+	if ((unsigned long long) file_size > (size_t) -1 / 2) {
+		printf_error("input file '%s' is too large", name);
+		goto out;
+	}
+
+	block_size = file_size < (long long) BLOCK_SIZE ? (unsigned long) file_size : BLOCK_SIZE;
+	max_packed = lz4_max_packed_size(block_size);
+	num_blocks = (unsigned long) ((file_size + block_size - 1) / block_size);
+	last_size = (unsigned long) (file_size - (long long) (num_blocks - 1) * block_size);
+
+	if ((data = (byte *) malloc((size_t) file_size)) == NULL
+	 || (depacked = (byte *) malloc((size_t) file_size)) == NULL
+	 || (packed = (byte *) malloc((size_t) num_blocks * max_packed)) == NULL
+	 || (packed_sizes = (unsigned long *) malloc(num_blocks * sizeof(packed_sizes[0]))) == NULL
+	 || (comp_speeds = (double *) malloc(num_runs * sizeof(comp_speeds[0]))) == NULL
+	 || (depack_speeds = (double *) malloc(num_runs * sizeof(depack_speeds[0]))) == NULL) {
+		printf_error("not enough memory");
+		goto out;
+	}
+
+	if (fread(data, 1, (size_t) file_size, file) != (size_t) file_size) {
+		printf_error("unable to read input file '%s'", name);
+		goto out;
+	}
+
+	for (level = first_level; level <= last_level; ++level) {
+		struct lz4_params params;
+		long long packed_total = 0;
+		double comp_best, comp_median;
+		double depack_best, depack_median;
+		size_t workmem_size;
+		unsigned long i;
+		int run;
+
+		if (get_params(&params, parser, level, overrides) != 0) {
+			printf_usage("invalid parser parameters");
+			goto out;
+		}
+
+		workmem_size = lz4_workmem_size_params(block_size, &params);
+
+		if (workmem_size > workmem_capacity) {
+			free(workmem);
+
+			if ((workmem = malloc(workmem_size)) == NULL) {
+				printf_error("not enough memory");
+				goto out;
+			}
+
+			workmem_capacity = workmem_size;
+		}
+
+		for (run = 0; run < num_runs; ++run) {
+			unsigned long loops = 0;
+			double start, secs;
+
+			/* Compress */
+			start = get_time();
+
+			do {
+				for (i = 0; i < num_blocks; ++i) {
+					const size_t offset = (size_t) i * block_size;
+					const unsigned long size = i + 1 < num_blocks ? block_size : last_size;
+
+					packed_sizes[i] = lz4_pack_params(data + offset, packed + (size_t) i * max_packed,
+					                                  size, workmem, &params);
+				}
+
+				++loops;
+				secs = get_time() - start;
+			} while (secs < BENCH_MIN_TIME);
+
+			comp_speeds[run] = mb_per_sec(file_size * (long long) loops, secs);
+
+			/* Decompress */
+			memset(depacked, 0, (size_t) file_size);
+
+			loops = 0;
+			start = get_time();
+
+			do {
+				for (i = 0; i < num_blocks; ++i) {
+					const size_t offset = (size_t) i * block_size;
+					const unsigned long size = i + 1 < num_blocks ? block_size : last_size;
+
+					if (lz4_depack_safe(packed + (size_t) i * max_packed, depacked + offset,
+					                    packed_sizes[i], size) != size) {
+						printf_error("decompression failed for '%s' at level %d", name, level);
+						goto out;
+					}
+				}
+
+				++loops;
+				secs = get_time() - start;
+			} while (secs < BENCH_MIN_TIME);
+
+			depack_speeds[run] = mb_per_sec(file_size * (long long) loops, secs);
+
+			/* Verify */
+			if (memcmp(data, depacked, (size_t) file_size) != 0) {
+				printf_error("decompressed data differs for '%s' at level %d", name, level);
+				goto out;
+			}
+		}
+
+		for (i = 0; i < num_blocks; ++i) {
+			packed_total += packed_sizes[i];
+		}
+
+		best_and_median(comp_speeds, num_runs, &comp_best, &comp_median);
+		best_and_median(depack_speeds, num_runs, &depack_best, &depack_median);
+
+		printf("%2d %s: %lld -> %lld (%u%%), compress %.1f/%.1f MB/s, decompress %.1f/%.1f MB/s\n",
+		       level, name, file_size, packed_total, ratio(packed_total, file_size),
+		       comp_best, comp_median, depack_best, depack_median);
+		fflush(stdout);
+	}
+
+	res = 0;
+
+out:
+	free(workmem);
+	free(depack_speeds);
+	free(comp_speeds);
+	free(packed_sizes);
+	free(packed);
+	free(depacked);
+	free(data);
+
+	if (file != NULL) {
+		fclose(file);
+	}
+
+	return res;
+}
+
+static void
+print_syntax(void)
+{
+	fputs("usage: blz4 [options] INFILE OUTFILE\n"
+	      "\n"
+	      "options:\n"
+	      "  -1                     compress fastest\n"
+	      "  -5                     compress faster (default)\n"
+	      "  -9                     compress better\n"
+	      "      --optimal          optimal but slow compression\n"
+	      "      --parser=NAME      use parser NAME (fast, lazy, leparse,\n"
+	      "                         ssparse, btparse, saparse) at the\n"
+	      "                         chosen level\n"
+	      "      --hash-bits=N      use N bits of hash for match finding (8-24)\n"
+	      "      --depth=N          check at most N matches at each position\n"
+	      "      --accept=N         take matches of length N without searching\n"
+	      "                         further (acceleration for fast parser)\n"
+	      "      --window=N         use matches up to offset N (1-65535)\n"
+	      "      --frame            use LZ4 frame format instead of legacy\n"
+	      "  -B ID                  frame block size ID, 4 (64 KiB) to 7 (4 MiB)\n"
+	      "      --linked           frame blocks may refer to previous blocks\n"
+	      "      --checksum         same as --block-checksum --content-checksum\n"
+	      "      --block-checksum   store checksum of each frame block\n"
+	      "      --content-checksum store checksum of uncompressed data in frame\n"
+	      "      --content-size     store size of uncompressed data in frame\n"
+	      "      --index            write seek index for random access\n"
+	      "      --stats[=FORMAT]   show statistics of the sequences in each block\n"
+	      "                         when compressing or decompressing, as text\n"
+	      "                         or json\n"
+	      "  -T N                   use N threads to compress or decompress\n"
+	      "  -d, --decompress       decompress\n"
+	      "      --peek=N           decompress first N bytes to OUTFILE or stdout\n"
+	      "  -b, --bench            benchmark compressing and decompressing FILEs\n"
+	      "                         in memory, from the chosen level\n"
+	      "  -e LEVEL               benchmark up to LEVEL (10 is --optimal)\n"
+	      "  -i N                   benchmark each level N times (default 3)\n"
+	      "      --range=BEGIN:END  decompress bytes BEGIN to END to OUTFILE or\n"
+	      "                         stdout, using seek index\n"
+	      "  -h, --help             print this help and exit\n"
+	      "      --kernel=NAME      use kernel NAME (auto, scalar, sse2, avx2)\n"
+	      "  -v, --verbose          verbose mode\n"
+	      "  -V, --version          print version and exit\n"
+	      "\n"
+	      "PLEASE NOTE: This is an experiment, use at your own risk.\n", stdout);
+}
+
+/*
+ * Parse range of the form BEGIN:END or BEGIN:, returning 0 on success.
+ */
+static int
+parse_range(const char *s, long long *begin, long long *end)
+{
+	char *p;
+
+	errno = 0;
+
+	*begin = strtoll(s, &p, 10);
+
+	if (errno != 0 || p == s || *p != ':' || *begin < 0) {
+		return -1;
+	}
+
+	s = p + 1;
+
+	/* Open range to end of data */
+	if (*s == '\0') {
+		*end = LLONG_MAX;
+		return 0;
+	}
+
+	*end = strtoll(s, &p, 10);
+
+	if (errno != 0 || p == s || *p != '\0' || *end < *begin) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Parse positive decimal number, returning 0 on success.
+ */
+static int
+parse_number(const char *s, unsigned long *value)
+{
+	char *end;
+
+	errno = 0;
+
+	*value = strtoul(s, &end, 10);
+
+	if (errno != 0 || end == s || *end != '\0' || *value == 0 || s[0] == '-') {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+parse_parser_name(const char *name)
+{
+	static const struct {
+		const char *name;
+		int parser;
+	} parsers[] = {
+		{ "fast", LZ4_PARSER_FAST },
+		{ "lazy", LZ4_PARSER_LAZY },
+		{ "leparse", LZ4_PARSER_LEPARSE },
+		{ "ssparse", LZ4_PARSER_SSPARSE },
+		{ "btparse", LZ4_PARSER_BTPARSE },
+		{ "saparse", LZ4_PARSER_SAPARSE }
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof(parsers) / sizeof(parsers[0]); ++i) {
+		if (strcmp(name, parsers[i].name) == 0) {
+			return parsers[i].parser;
+		}
+	}
+
+	return -1;
+}
+
+static int
+parse_kernel_name(const char *name)
+{
+	int kernel;
+
+	for (kernel = LZ4_KERNEL_AUTO; lz4_kernel_name(kernel) != NULL; ++kernel) {
+		if (strcmp(name, lz4_kernel_name(kernel)) == 0) {
+			return kernel;
+		}
+	}
+
+	return -1;
+}
+
+static void
+print_version(void)
+{
+	fputs("blz4 " LZ4_VER_STRING "\n"
+	      "\n"
+	      "Copyright (c) 2018-2020 Joergen Ibsen\n"
+	      "\n"
+	      "Licensed under the zlib license (Zlib).\n"
+	      "There is NO WARRANTY, to the extent permitted by law.\n", stdout);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct parg_state ps;
+	const char *infile = NULL;
+	const char *outfile = NULL;
+	int flag_decompress = 0;
+	int flag_verbose = 0;
+	int flag_frame = 0;
+	struct frame_options frame = { 7, 0, 0, 0, 0 };
+	int parser = LZ4_PARSER_DEFAULT;
+	int kernel = LZ4_KERNEL_AUTO;
+	int level = 5;
+	struct lz4_params params;
+	struct lz4_params overrides;
+	unsigned long hash_bits = 0, max_depth = 0, accept_len = 0, window_size = 0;
+	int num_threads = 1;
+	int flag_bench = 0;
+	int bench_last_level = 0;
+	int bench_runs = 3;
+	long long peek_size = -1;
+	long long range_begin = -1, range_end = -1;
+	int flag_index = 0;
+	int flag_stats = 0;
+	int stats_json = 0;
+	struct seq_report report;
+	int res;
+	const char *optstring = "123456789B:bde:hi:T:vVx";
+	int optend;
+	int c;
+
+	const struct parg_option long_options[] = {
+		{ "accept", PARG_REQARG, NULL, 'A' },
+		{ "bench", PARG_NOARG, NULL, 'b' },
+		{ "block-checksum", PARG_NOARG, NULL, 'X' },
+		{ "checksum", PARG_NOARG, NULL, 'c' },
+		{ "content-checksum", PARG_NOARG, NULL, 'C' },
+		{ "content-size", PARG_NOARG, NULL, 'S' },
+		{ "decompress", PARG_NOARG, NULL, 'd' },
+		{ "depth", PARG_REQARG, NULL, 'D' },
+		{ "frame", PARG_NOARG, NULL, 'f' },
+		{ "hash-bits", PARG_REQARG, NULL, 'H' },
+		{ "help", PARG_NOARG, NULL, 'h' },
+		{ "index", PARG_NOARG, NULL, 'I' },
+		{ "kernel", PARG_REQARG, NULL, 'k' },
+		{ "linked", PARG_NOARG, NULL, 'l' },
+		{ "optimal", PARG_NOARG, NULL, 'x' },
+		{ "parser", PARG_REQARG, NULL, 'p' },
+		{ "peek", PARG_REQARG, NULL, 'P' },
+		{ "range", PARG_REQARG, NULL, 'R' },
+		{ "stats", PARG_OPTARG, NULL, 's' },
 		{ "verbose", PARG_NOARG, NULL, 'v' },
 		{ "version", PARG_NOARG, NULL, 'V' },
+		{ "window", PARG_REQARG, NULL, 'W' },
 		{ 0, 0, 0, 0 }
 	};
 
 	parg_init(&ps);
 
-	while ((c = parg_getopt_long(&ps, argc, argv, "56789dhvVx", long_options, NULL)) != -1) {
+	/* Move file names to the end, since benchmark mode takes any number */
+	optend = parg_reorder(argc, argv, optstring, long_options);
+
+	while ((c = parg_getopt_long(&ps, optend, argv, optstring, long_options, NULL)) != -1) {
 		switch (c) {
-		case 1:
-			if (infile == NULL) {
-				infile = ps.optarg;
-			}
-			else if (outfile == NULL) {
-				outfile = ps.optarg;
-			}
-			else {
-				printf_usage("too many arguments");
-				return EXIT_FAILURE;
-			}
-			break;
+		case '1':
+		case '2':
+		case '3':
+		case '4':
 		case '5':
 		case '6':
 		case '7':
@@ -456,9 +2355,140 @@ main(int argc, char *argv[])
 		case 'x':
 			level = 10;
 			break;
+		case 'p':
+			parser = parse_parser_name(ps.optarg);
+			if (parser < 0) {
+				printf_usage("unknown parser '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'H':
+			if (parse_number(ps.optarg, &hash_bits) != 0) {
+				printf_usage("invalid number of hash bits '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'D':
+			if (parse_number(ps.optarg, &max_depth) != 0) {
+				printf_usage("invalid depth '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'A':
+			if (parse_number(ps.optarg, &accept_len) != 0) {
+				printf_usage("invalid accept length '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'W':
+			if (parse_number(ps.optarg, &window_size) != 0) {
+				printf_usage("invalid window size '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'k':
+			kernel = parse_kernel_name(ps.optarg);
+			if (kernel < 0) {
+				printf_usage("unknown kernel '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'f':
+			flag_frame = 1;
+			break;
+		case 'B':
+			if (ps.optarg[0] < '4' || ps.optarg[0] > '7' || ps.optarg[1] != '\0') {
+				printf_usage("invalid block size ID '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			frame.block_size_id = ps.optarg[0] - '0';
+			flag_frame = 1;
+			break;
+		case 'l':
+			frame.linked = 1;
+			flag_frame = 1;
+			break;
+		case 'c':
+			frame.block_checksum = 1;
+			frame.content_checksum = 1;
+			flag_frame = 1;
+			break;
+		case 'X':
+			frame.block_checksum = 1;
+			flag_frame = 1;
+			break;
+		case 'C':
+			frame.content_checksum = 1;
+			flag_frame = 1;
+			break;
+		case 'S':
+			frame.content_size = 1;
+			flag_frame = 1;
+			break;
+		case 'T':
+			num_threads = atoi(ps.optarg);
+			if (num_threads < 1 || num_threads > MAX_THREADS) {
+				printf_usage("invalid number of threads '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			break;
 		case 'd':
 			flag_decompress = 1;
 			break;
+		case 'b':
+			flag_bench = 1;
+			break;
+		case 'e':
+			bench_last_level = atoi(ps.optarg);
+			if (bench_last_level < 1 || bench_last_level > 10) {
+				printf_usage("invalid level '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			flag_bench = 1;
+			break;
+		case 'i':
+			bench_runs = atoi(ps.optarg);
+			if (bench_runs < 1 || bench_runs > 1000) {
+				printf_usage("invalid number of runs '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			flag_bench = 1;
+			break;
+		case 'P':
+			{
+				char *end;
+
+				errno = 0;
+				peek_size = strtoll(ps.optarg, &end, 10);
+				if (errno != 0 || end == ps.optarg || *end != '\0' || peek_size < 0) {
+					printf_usage("invalid peek size '%s'", ps.optarg);
+					return EXIT_FAILURE;
+				}
+			}
+			flag_decompress = 1;
+			break;
+		case 'R':
+			if (parse_range(ps.optarg, &range_begin, &range_end) != 0) {
+				printf_usage("invalid range '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'I':
+			flag_index = 1;
+			break;
+		case 's':
+			if (ps.optarg == NULL || strcmp(ps.optarg, "text") == 0) {
+				stats_json = 0;
+			}
+			else if (strcmp(ps.optarg, "json") == 0) {
+				stats_json = 1;
+			}
+			else {
+				printf_usage("unknown stats format '%s'", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			flag_stats = 1;
+			break;
 		case 'h':
 			print_syntax();
 			return EXIT_SUCCESS;
@@ -477,17 +2507,96 @@ main(int argc, char *argv[])
 		}
 	}
 
-	if (outfile == NULL) {
+	/* Remaining arguments are file names */
+	infile = ps.optind < argc ? argv[ps.optind] : NULL;
+	outfile = ps.optind + 1 < argc ? argv[ps.optind + 1] : NULL;
+
+	if (!flag_bench && ps.optind + 2 < argc) {
+		printf_usage("too many arguments");
+		return EXIT_FAILURE;
+	}
+
+	/* Peek and range write to stdout if no output file is given */
+	if (infile == NULL || (outfile == NULL && !flag_bench && peek_size < 0 && range_begin < 0)) {
 		printf_usage("too few arguments");
 		return EXIT_FAILURE;
 	}
 
+	if (flag_stats && (flag_bench || peek_size >= 0 || range_begin >= 0)) {
+		printf_usage("--stats cannot be used with -b, --peek or --range");
+		return EXIT_FAILURE;
+	}
+
+	if (flag_index && frame.linked) {
+		printf_usage("seek index requires independent blocks, not --linked");
+		return EXIT_FAILURE;
+	}
+
+	/* Start from parameters of level, and apply any given */
+	overrides.parser = parser;
+	overrides.hash_bits = hash_bits > INT_MAX ? INT_MAX : (int) hash_bits;
+	overrides.max_depth = max_depth;
+	overrides.accept_len = accept_len;
+	overrides.window_size = window_size;
+
+	if (get_params(&params, parser, level, &overrides) != 0) {
+		printf_usage("invalid parser parameters");
+		return EXIT_FAILURE;
+	}
+
+	if (bench_last_level == 0) {
+		bench_last_level = level;
+	}
+
+	if (flag_bench && bench_last_level < level) {
+		printf_usage("last level %d is before first level %d", bench_last_level, level);
+		return EXIT_FAILURE;
+	}
+
+	if (lz4_set_kernel(kernel) < 0) {
+		printf_error("kernel '%s' not supported by CPU", lz4_kernel_name(kernel));
+		return EXIT_FAILURE;
+	}
+
+	if (flag_verbose) {
+		fprintf(stderr, "using %s kernels\n", lz4_kernel_name(lz4_get_kernel()));
+	}
+
+	if (flag_bench) {
+		int i;
+
+		for (i = ps.optind; i < argc; ++i) {
+			if (bench_file(argv[i], parser, level, bench_last_level,
+			               &overrides, bench_runs) != 0) {
+				return EXIT_FAILURE;
+			}
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	if (range_begin >= 0) {
+		return range_file(infile, outfile, (unsigned long long) range_begin,
+		                  (unsigned long long) range_end);
+	}
+
+	if (flag_stats) {
+		seq_report_begin(&report, stdout, stats_json);
+	}
+
 	if (flag_decompress) {
-		return decompress_file(infile, outfile, flag_verbose);
+		res = decompress_file(infile, outfile, flag_verbose, num_threads,
+		                      peek_size, flag_stats ? &report : NULL);
 	}
 	else {
-		return compress_file(infile, outfile, flag_verbose, level);
+		res = compress_file(infile, outfile, flag_verbose, &params,
+		                    flag_frame ? &frame : NULL, num_threads, flag_index,
+		                    flag_stats ? &report : NULL);
+	}
+
+	if (flag_stats && res == 0) {
+		seq_report_end(&report);
 	}
 
-	return EXIT_SUCCESS;
+	return res;
 }
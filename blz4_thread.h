@@ -0,0 +1,292 @@
+/*
+ * blz4 - Example of LZ4 compression with BriefLZ algorithms
+ *
+ * Minimal portable threads, mutexes and condition variables
+ *
+ * Copyright (c) 2026 Joergen Ibsen
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must
+ *      not claim that you wrote the original software. If you use this
+ *      software in a product, an acknowledgment in the product
+ *      documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must
+ *      not be misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *      distribution.
+ */
+
+#ifndef BLZ4_THREAD_H_INCLUDED
+#define BLZ4_THREAD_H_INCLUDED
+
+/*
+ * Uses Win32 threads, slim reader/writer locks, condition variables and
+ * one-time initialization on Windows (Vista or later), and POSIX threads
+ * elsewhere.
+ *
+ * All functions except blz4_thread_create assume success, like the
+ * pthreads functions they wrap do in practice.
+ */
+
+#if defined(_WIN32)
+
+#ifndef WIN32_LEAN_AND_MEAN
+#  define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+struct blz4_thread {
+	HANDLE handle;
+	void (*func)(void *);
+	void *arg;
+};
+
+struct blz4_mutex {
+	SRWLOCK lock;
+};
+
+struct blz4_cond {
+	CONDITION_VARIABLE cond;
+};
+
+struct blz4_once {
+	INIT_ONCE once;
+};
+
+#define BLZ4_ONCE_INIT { INIT_ONCE_STATIC_INIT }
+
+static DWORD WINAPI
+blz4_thread_start(LPVOID param)
+{
+	struct blz4_thread *thread = (struct blz4_thread *) param;
+
+	thread->func(thread->arg);
+
+	return 0;
+}
+
+/*
+ * Start thread running `func(arg)`, returning 0 on success.
+ */
+static inline int
+blz4_thread_create(struct blz4_thread *thread, void (*func)(void *), void *arg)
+{
+	thread->func = func;
+	thread->arg = arg;
+	thread->handle = CreateThread(NULL, 0, blz4_thread_start, thread, 0, NULL);
+
+	return thread->handle != NULL ? 0 : -1;
+}
+
+static inline void
+blz4_thread_join(struct blz4_thread *thread)
+{
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+}
+
+static inline void
+blz4_mutex_init(struct blz4_mutex *mutex)
+{
+	InitializeSRWLock(&mutex->lock);
+}
+
+static inline void
+blz4_mutex_destroy(struct blz4_mutex *mutex)
+{
+	(void) mutex;
+}
+
+static inline void
+blz4_mutex_lock(struct blz4_mutex *mutex)
+{
+	AcquireSRWLockExclusive(&mutex->lock);
+}
+
+static inline void
+blz4_mutex_unlock(struct blz4_mutex *mutex)
+{
+	ReleaseSRWLockExclusive(&mutex->lock);
+}
+
+static inline void
+blz4_cond_init(struct blz4_cond *cond)
+{
+	InitializeConditionVariable(&cond->cond);
+}
+
+static inline void
+blz4_cond_destroy(struct blz4_cond *cond)
+{
+	(void) cond;
+}
+
+static inline void
+blz4_cond_wait(struct blz4_cond *cond, struct blz4_mutex *mutex)
+{
+	SleepConditionVariableSRW(&cond->cond, &mutex->lock, INFINITE, 0);
+}
+
+static inline void
+blz4_cond_signal(struct blz4_cond *cond)
+{
+	WakeConditionVariable(&cond->cond);
+}
+
+static inline void
+blz4_cond_broadcast(struct blz4_cond *cond)
+{
+	WakeAllConditionVariable(&cond->cond);
+}
+
+static BOOL CALLBACK
+blz4_once_start(PINIT_ONCE once, PVOID param, PVOID *context)
+{
+	void (**func)(void) = (void (**)(void)) param;
+
+	(void) once;
+	(void) context;
+
+	(*func)();
+
+	return TRUE;
+}
+
+/*
+ * Run `func` once, the first time this is called with `once`. Other
+ * threads calling it at the same time wait until `func` has returned.
+ */
+static inline void
+blz4_once_call(struct blz4_once *once, void (*func)(void))
+{
+	InitOnceExecuteOnce(&once->once, blz4_once_start, (PVOID) &func, NULL);
+}
+
+#else /* _WIN32 */
+
+#include <pthread.h>
+
+struct blz4_thread {
+	pthread_t handle;
+	void (*func)(void *);
+	void *arg;
+};
+
+struct blz4_mutex {
+	pthread_mutex_t lock;
+};
+
+struct blz4_cond {
+	pthread_cond_t cond;
+};
+
+struct blz4_once {
+	pthread_once_t once;
+};
+
+#define BLZ4_ONCE_INIT { PTHREAD_ONCE_INIT }
+
+static void *
+blz4_thread_start(void *param)
+{
+	struct blz4_thread *thread = (struct blz4_thread *) param;
+
+	thread->func(thread->arg);
+
+	return NULL;
+}
+
+/*
+ * Start thread running `func(arg)`, returning 0 on success.
+ */
+static inline int
+blz4_thread_create(struct blz4_thread *thread, void (*func)(void *), void *arg)
+{
+	thread->func = func;
+	thread->arg = arg;
+
+	return pthread_create(&thread->handle, NULL, blz4_thread_start, thread) == 0 ? 0 : -1;
+}
+
+static inline void
+blz4_thread_join(struct blz4_thread *thread)
+{
+	pthread_join(thread->handle, NULL);
+}
+
+static inline void
+blz4_mutex_init(struct blz4_mutex *mutex)
+{
+	pthread_mutex_init(&mutex->lock, NULL);
+}
+
+static inline void
+blz4_mutex_destroy(struct blz4_mutex *mutex)
+{
+	pthread_mutex_destroy(&mutex->lock);
+}
+
+static inline void
+blz4_mutex_lock(struct blz4_mutex *mutex)
+{
+	pthread_mutex_lock(&mutex->lock);
+}
+
+static inline void
+blz4_mutex_unlock(struct blz4_mutex *mutex)
+{
+	pthread_mutex_unlock(&mutex->lock);
+}
+
+static inline void
+blz4_cond_init(struct blz4_cond *cond)
+{
+	pthread_cond_init(&cond->cond, NULL);
+}
+
+static inline void
+blz4_cond_destroy(struct blz4_cond *cond)
+{
+	pthread_cond_destroy(&cond->cond);
+}
+
+static inline void
+blz4_cond_wait(struct blz4_cond *cond, struct blz4_mutex *mutex)
+{
+	pthread_cond_wait(&cond->cond, &mutex->lock);
+}
+
+static inline void
+blz4_cond_signal(struct blz4_cond *cond)
+{
+	pthread_cond_signal(&cond->cond);
+}
+
+static inline void
+blz4_cond_broadcast(struct blz4_cond *cond)
+{
+	pthread_cond_broadcast(&cond->cond);
+}
+
+/*
+ * Run `func` once, the first time this is called with `once`. Other
+ * threads calling it at the same time wait until `func` has returned.
+ */
+static inline void
+blz4_once_call(struct blz4_once *once, void (*func)(void))
+{
+	pthread_once(&once->once, func);
+}
+
+#endif /* _WIN32 */
+
+#endif /* BLZ4_THREAD_H_INCLUDED */
@@ -25,11 +25,27 @@
 //      distribution.
 //
 
+// For clock_gettime used for stats
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#  define _POSIX_C_SOURCE 200112L
+#endif
+
 #include "lz4.h"
+#include "lz4_kernels.h"
 
 #include <assert.h>
 #include <limits.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#endif
 
 #if _MSC_VER >= 1400
 #  include <intrin.h>
@@ -42,9 +58,10 @@
 #  define LZ4_BUILTIN_GCC
 #endif
 
-// Number of bits of hash to use for lookup.
+// Default number of bits of hash to use for lookup.
 //
-// The size of the lookup table (and thus workmem) depends on this.
+// The size of the lookup table (and thus workmem) depends on this. It can be
+// changed at runtime with hash_bits of struct lz4_params.
 //
 // Values between 10 and 18 work well. Lower values generally make compression
 // speed faster but ratio worse. The default value 17 (128k entries) is a
@@ -54,9 +71,8 @@
 #  define LZ4_HASH_BITS 17
 #endif
 
-#define LOOKUP_SIZE (1UL << LZ4_HASH_BITS)
-
-#define WORKMEM_SIZE (LOOKUP_SIZE * sizeof(uint32_t))
+#define LZ4_HASH_BITS_MIN 8
+#define LZ4_HASH_BITS_MAX 24
 
 #define NO_MATCH_POS ((uint32_t) -1)
 
@@ -82,6 +98,18 @@ lz4_log2(unsigned long n)
 #endif
 }
 
+// Get length of match between a and b, which are known to match in the
+// first len bytes, up to a maximum of len_limit.
+//
+// This uses the kernel selected for the CPU, see lz4_kernels.c.
+//
+static unsigned long
+lz4_match_len(const unsigned char *a, const unsigned char *b,
+              unsigned long len, unsigned long len_limit)
+{
+	return lz4_kernels->match_len(a, b, len, len_limit);
+}
+
 // Hash four bytes starting a p.
 //
 // This is Fibonacci hashing, also known as Knuth's multiplicative hash. The
@@ -100,6 +128,68 @@ lz4_hash4_bits(const unsigned char *p, int bits)
 	return (val * UINT32_C(2654435761)) >> (32 - bits);
 }
 
+// Hash eight bytes starting at p.
+//
+// This is Fibonacci hashing like lz4_hash4_bits, with a 64-bit constant
+// close to 2^64/phi.
+//
+static unsigned long
+lz4_hash8_bits(const unsigned char *p, int bits)
+{
+	assert(bits > 0 && bits <= 32);
+
+	uint64_t val = (uint64_t) p[0]
+	             | ((uint64_t) p[1] << 8)
+	             | ((uint64_t) p[2] << 16)
+	             | ((uint64_t) p[3] << 24)
+	             | ((uint64_t) p[4] << 32)
+	             | ((uint64_t) p[5] << 40)
+	             | ((uint64_t) p[6] << 48)
+	             | ((uint64_t) p[7] << 56);
+
+	return (unsigned long) ((val * UINT64_C(11400714819323198485)) >> (64 - bits));
+}
+
+// Get number of hash bits to use for a lookup for input of src_size bytes.
+//
+// There is little point in having many more entries in the lookup table
+// than there are positions in the input, so we limit the size to keep
+// initialization cheap on small inputs.
+//
+static int
+lz4_lookup_bits(size_t src_size, int max_bits)
+{
+	const int bits = src_size > 256 ? lz4_log2((unsigned long) src_size) + 1 : 8;
+
+	return bits < max_bits ? bits : max_bits;
+}
+
+// Get time in seconds from a monotonic clock, or 0 if stats is NULL, so
+// parsers only read the clock when gathering stats.
+//
+static double
+lz4_stats_time(const struct lz4_pack_stats *stats)
+{
+	if (stats == NULL) {
+		return 0.0;
+	}
+
+#if defined(_WIN32)
+	LARGE_INTEGER count, freq;
+
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&freq);
+
+	return (double) count.QuadPart / (double) freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+#endif
+}
+
 static unsigned long
 lz4_literal_cost(unsigned long nlit)
 {
@@ -112,6 +202,110 @@ lz4_match_cost(unsigned long len)
 	return 1 + 2 + (len + 255 - 19) / 255;
 }
 
+// Output a sequence of nlit literals from lit followed by a match of length
+// len at offset offs.
+//
+// If len is zero, only the literals are output, as the last incomplete
+// sequence.
+//
+// Returns a pointer to the byte following the sequence.
+//
+static unsigned char *
+lz4_write_sequence(unsigned char *out, const unsigned char *lit,
+                   unsigned long nlit, unsigned long offs, unsigned long len)
+{
+	assert(len == 0 || (len >= 4 && offs > 0 && offs <= 65535));
+
+	// Make room for token
+	unsigned char *token_out = out++;
+
+	unsigned long token_lit = nlit;
+
+	// Output extra literal length bytes
+	while (token_lit >= 15 + 255) {
+		*out++ = 255;
+		token_lit -= 255;
+	}
+	if (token_lit >= 15) {
+		*out++ = token_lit - 15;
+		token_lit = 15;
+	}
+
+	// Output literals
+	memcpy(out, lit, nlit);
+	out += nlit;
+
+	// Handle last incomplete sequence
+	if (len == 0) {
+		// Write token
+		*token_out = token_lit << 4;
+		return out;
+	}
+
+	// Output offset
+	*out++ = offs & 0xFF;
+	*out++ = (offs >> 8) & 0xFF;
+
+	// Output extra length bytes
+	while (len >= 19 + 255) {
+		*out++ = 255;
+		len -= 255;
+	}
+	if (len >= 19) {
+		*out++ = len - 19;
+		len = 19;
+	}
+
+	// Write token
+	*token_out = (token_lit << 4) | (len - 4);
+
+	return out;
+}
+
+// Get size of nlit bytes output as a single run of literals.
+//
+static unsigned long
+lz4_literal_run_size(unsigned long nlit)
+{
+	return 1 + lz4_literal_cost(nlit) + nlit;
+}
+
+// Get the size of the output of a parser, which is up to out, counting
+// the literals from next_lit to cur still to be output as one byte each.
+//
+static unsigned long
+lz4_output_size(const unsigned char *dst, const unsigned char *out,
+                unsigned long next_lit, unsigned long cur)
+{
+	return (unsigned long) (out - dst) + (cur - next_lit);
+}
+
+// Number of bytes of input in the regions checked by lz4_region_shrinks,
+// except in btparse, which checks each chunk.
+//
+#define LZ4_REGION_SIZE (1UL << 16)
+
+// Check if a region of region_len bytes of input shrank, where the output
+// size was size_before at its start and is size_after at its end, see
+// lz4_output_size.
+//
+// It has to shrink by more than 1/1024, so a few matches found by chance
+// in data that does not compress do not count.
+//
+// The lazy parser and btparse check this for each region of input they
+// search, and if it did not shrink, they compress the next region with
+// lz4_fastparse_stretch, which skips quickly over data without matches.
+// When a region does shrink, they go back to the start of it and search
+// from there, so only the parts of the input that do not compress are
+// skipped.
+//
+static int
+lz4_region_shrinks(unsigned long size_before, unsigned long size_after,
+                   unsigned long region_len)
+{
+	return size_after - size_before < region_len - region_len / 1024;
+}
+
 unsigned long
 lz4_max_packed_size(unsigned long src_size)
 {
@@ -119,49 +313,517 @@ lz4_max_packed_size(unsigned long src_size)
 }
 
 // Include compression algorithms used by lz4_pack_level
+//
+// The fast parser goes first, because the others use lz4_fastparse_stretch.
+//
+#include "lz4_fastparse.h"
 #include "lz4_btparse.h"
+#include "lz4_lazyparse.h"
 #include "lz4_leparse.h"
+#include "lz4_saparse.h"
+#include "lz4_ssparse.h"
+
+// Parser and search parameters for each compression level.
+//
+// The fast parser does not search, so instead of max_depth it uses the
+// number of hash bits, and accept_len is the acceleration. The suffix
+// array parser always finds the longest match, so it uses neither.
+// leparse and ssparse use up to log2 of the input size bits of hash, so
+// their levels use the maximum, and only the input size limits it.
+//
+static const struct lz4_level_params {
+	int parser;
+	int hash_bits;
+	unsigned long max_depth;
+	unsigned long accept_len;
+} lz4_levels[] = {
+	{ LZ4_PARSER_DEFAULT, 0, 0, 0 },
+	{ LZ4_PARSER_FAST, 14, 1, 4 },
+	{ LZ4_PARSER_FAST, 16, 1, 2 },
+	{ LZ4_PARSER_FAST, 16, 1, 1 },
+	{ LZ4_PARSER_FAST, LZ4_HASH_BITS, 1, 1 },
+	{ LZ4_PARSER_LEPARSE, LZ4_HASH_BITS_MAX, 1, 18 },
+	{ LZ4_PARSER_LEPARSE, LZ4_HASH_BITS_MAX, 8, 32 },
+	{ LZ4_PARSER_LEPARSE, LZ4_HASH_BITS_MAX, 64, 64 },
+	{ LZ4_PARSER_BTPARSE, LZ4_HASH_BITS, 16, 96 },
+	{ LZ4_PARSER_BTPARSE, LZ4_HASH_BITS, 32, 224 },
+	{ LZ4_PARSER_SAPARSE, LZ4_HASH_BITS, ULONG_MAX, ULONG_MAX }
+};
+
+#define LZ4_MAX_LEVEL ((int) (sizeof(lz4_levels) / sizeof(lz4_levels[0])) - 1)
+
+// Search parameters of the lazy parser.
+//
+// The lazy parser is faster than level 5, but does not compress better
+// than it on all data, so no level uses it. When selected as parser,
+// the first is used for levels up to 6, and the second above.
+//
+static const struct lz4_level_params lz4_lazy_levels[] = {
+	{ LZ4_PARSER_LAZY, LZ4_HASH_BITS, 8, 32 },
+	{ LZ4_PARSER_LAZY, LZ4_HASH_BITS, 16, 64 }
+};
+
+static int
+lz4_params_valid(const struct lz4_params *params)
+{
+	switch (params->parser) {
+	case LZ4_PARSER_FAST:
+	case LZ4_PARSER_LAZY:
+	case LZ4_PARSER_LEPARSE:
+	case LZ4_PARSER_SSPARSE:
+	case LZ4_PARSER_BTPARSE:
+	case LZ4_PARSER_SAPARSE:
+		break;
+	default:
+		return 0;
+	}
+
+	return params->hash_bits >= LZ4_HASH_BITS_MIN
+	    && params->hash_bits <= LZ4_HASH_BITS_MAX
+	    && params->max_depth > 0
+	    && params->accept_len > 0
+	    && params->window_size > 0
+	    && params->window_size <= 65535;
+}
+
+int
+lz4_params_level(struct lz4_params *params, int parser, int level)
+{
+	if (level < 1 || level > LZ4_MAX_LEVEL) {
+		return -1;
+	}
+
+	const struct lz4_level_params *level_params = &lz4_levels[level];
+
+	if (parser == LZ4_PARSER_DEFAULT) {
+		parser = level_params->parser;
+	}
+
+	if (parser == LZ4_PARSER_FAST) {
+		// Use the best settings of the fast parser for the other
+		// levels
+		if (level_params->parser != LZ4_PARSER_FAST) {
+			level_params = &lz4_levels[4];
+		}
+	}
+	else if (parser == LZ4_PARSER_LAZY) {
+		level_params = &lz4_lazy_levels[level <= 6 ? 0 : 1];
+	}
+	else if (level_params->parser == LZ4_PARSER_FAST) {
+		// Use the search parameters of level 5 for the fast levels
+		level_params = &lz4_levels[5];
+	}
+
+	params->parser = parser;
+	params->hash_bits = level_params->hash_bits;
+	params->max_depth = level_params->max_depth;
+	params->accept_len = level_params->accept_len;
+	params->window_size = 65535;
+
+	return lz4_params_valid(params) ? 0 : -1;
+}
 
 size_t
-lz4_workmem_size_level(size_t src_size, int level)
+lz4_workmem_size_params(size_t src_size, const struct lz4_params *params)
 {
-	switch (level) {
-	case 5:
-	case 6:
-	case 7:
-		return lz4_leparse_workmem_size(src_size);
-	case 8:
-	case 9:
-	case 10:
-		return lz4_btparse_workmem_size(src_size);
+	if (!lz4_params_valid(params)) {
+		return (size_t) -1;
+	}
+
+	switch (params->parser) {
+	case LZ4_PARSER_FAST:
+		return lz4_fastparse_workmem_size(src_size, params->hash_bits);
+	case LZ4_PARSER_LAZY:
+		return lz4_lazyparse_workmem_size(src_size, params->hash_bits);
+	case LZ4_PARSER_LEPARSE:
+		return lz4_leparse_workmem_size(src_size, params->hash_bits);
+	case LZ4_PARSER_SSPARSE:
+		return lz4_ssparse_workmem_size(src_size, params->hash_bits);
+	case LZ4_PARSER_BTPARSE:
+		return lz4_btparse_workmem_size(src_size, params->hash_bits);
+	case LZ4_PARSER_SAPARSE:
+		return lz4_saparse_workmem_size(src_size, params->hash_bits);
 	default:
 		return (size_t) -1;
 	}
 }
 
+size_t
+lz4_workmem_size_parser(size_t src_size, int parser, int level)
+{
+	struct lz4_params params;
+
+	if (lz4_params_level(&params, parser, level) != 0) {
+		return (size_t) -1;
+	}
+
+	return lz4_workmem_size_params(src_size, &params);
+}
+
+// Compress the input from dict_size with the fast parser, one region at a
+// time, stopping at the first region that shrinks.
+//
+// leparse, ssparse and saparse parse the whole input before they output
+// anything, and take as long on data that does not compress as on data
+// that does, so this is checked before running them. If no region shrinks,
+// the output of the fast parser is complete, and its size is returned.
+// Otherwise 0 is returned, and the parser should run.
+//
+// The lookup is placed at the start of workmem, which has room for it
+// for input of at least LZ4_REGION_SIZE bytes.
+//
+static unsigned long
+lz4_pack_fast_trial(const void *src, void *dst, unsigned long src_size,
+                    unsigned long dict_size, void *workmem,
+                    const struct lz4_params *params)
+{
+	const unsigned char *const in = (const unsigned char *) src;
+	const unsigned long last_match_pos = src_size - 12;
+
+	assert(src_size - dict_size >= LZ4_REGION_SIZE);
+
+	uint32_t *const lookup = (uint32_t *) workmem;
+
+	// Initialize lookup
+	for (unsigned long i = 0; i < (1UL << LZ4_FASTPARSE_STRETCH_BITS); ++i) {
+		lookup[i] = NO_MATCH_POS;
+	}
+
+	unsigned char *out = (unsigned char *) dst;
+
+	// Start of literals not yet output
+	unsigned long next_lit = dict_size;
+
+	unsigned long cur = dict_size;
+
+	while (cur <= last_match_pos) {
+		const unsigned long region_cur = cur;
+		const unsigned long region_size = lz4_output_size((unsigned char *) dst, out, next_lit, cur);
+
+		out = lz4_fastparse_stretch(in, out, src_size, &cur, cur + LZ4_REGION_SIZE, &next_lit,
+		                            lookup, LZ4_FASTPARSE_STRETCH_BITS, 1, params->window_size);
+
+		if (lz4_region_shrinks(region_size, lz4_output_size((unsigned char *) dst, out, next_lit, cur),
+		                       cur - region_cur)) {
+			return 0;
+		}
+	}
+
+	// Output last literals
+	out = lz4_write_sequence(out, &in[next_lit], src_size - next_lit, 0, 0);
+
+	return (unsigned long) (out - (unsigned char *) dst);
+}
+
+// Compress src_size - dict_size bytes starting at src + dict_size.
+//
+// The parsers all take the size of the whole buffer, and treat the first
+// dict_size bytes as history that matches may refer to.
+//
+// If stats is not NULL, the parsers that support it add to it.
+//
+static unsigned long
+lz4_pack_params_prefix(const void *src, void *dst, unsigned long src_size,
+                       unsigned long dict_size, void *workmem,
+                       const struct lz4_params *params,
+                       struct lz4_pack_stats *stats)
+{
+	if (!lz4_params_valid(params)) {
+		return LZ4_ERROR;
+	}
+
+	lz4_kernels_init();
+
+	// Output input without room for a match as literals, without
+	// setting up a parser
+	if (src_size - dict_size < 13) {
+		const unsigned char *in = (const unsigned char *) src + dict_size;
+		unsigned char *out = lz4_write_sequence((unsigned char *) dst, in, src_size - dict_size, 0, 0);
+
+		return (unsigned long) (out - (unsigned char *) dst);
+	}
+
+	unsigned long packed_size = 0;
+
+	// Check if any region shrinks with the fast parser before running a
+	// parser that parses all of the input, see lz4_pack_fast_trial
+	if ((params->parser == LZ4_PARSER_LEPARSE
+	  || params->parser == LZ4_PARSER_SSPARSE
+	  || params->parser == LZ4_PARSER_SAPARSE)
+	 && src_size - dict_size >= LZ4_REGION_SIZE) {
+		packed_size = lz4_pack_fast_trial(src, dst, src_size, dict_size, workmem, params);
+	}
+
+	if (packed_size == 0) {
+		switch (params->parser) {
+		case LZ4_PARSER_FAST:
+			packed_size = lz4_pack_fastparse(src, dst, src_size, dict_size, workmem, params);
+			break;
+		case LZ4_PARSER_LAZY:
+			packed_size = lz4_pack_lazyparse(src, dst, src_size, dict_size, workmem, params);
+			break;
+		case LZ4_PARSER_LEPARSE:
+			packed_size = lz4_pack_leparse(src, dst, src_size, dict_size, workmem, params, stats);
+			break;
+		case LZ4_PARSER_SSPARSE:
+			packed_size = lz4_pack_ssparse(src, dst, src_size, dict_size, workmem, params);
+			break;
+		case LZ4_PARSER_BTPARSE:
+			packed_size = lz4_pack_btparse(src, dst, src_size, dict_size, workmem, params, stats, ULONG_MAX);
+			break;
+		case LZ4_PARSER_SAPARSE:
+			packed_size = lz4_pack_saparse(src, dst, src_size, dict_size, workmem, params);
+			break;
+		default:
+			return LZ4_ERROR;
+		}
+	}
+
+	// Output input that did not shrink as a single run of literals, if
+	// that is smaller, which the frame format then stores uncompressed
+	//
+	// The lazy parser and btparse use the fast parser for regions that do
+	// not shrink, see lz4_region_shrinks, and the other parsers only run
+	// if some region shrinks with the fast parser, see lz4_pack_fast_trial.
+	//
+	if (packed_size > lz4_literal_run_size(src_size - dict_size)) {
+		const unsigned char *in = (const unsigned char *) src + dict_size;
+		unsigned char *out = lz4_write_sequence((unsigned char *) dst, in, src_size - dict_size, 0, 0);
+
+		packed_size = (unsigned long) (out - (unsigned char *) dst);
+	}
+
+	return packed_size;
+}
+
+unsigned long
+lz4_pack_params(const void *src, void *dst, unsigned long src_size,
+                void *workmem, const struct lz4_params *params)
+{
+	return lz4_pack_params_prefix(src, dst, src_size, 0, workmem, params, NULL);
+}
+
+unsigned long
+lz4_pack_params_stats(const void *src, void *dst, unsigned long src_size,
+                      void *workmem, const struct lz4_params *params,
+                      struct lz4_pack_stats *stats)
+{
+	return lz4_pack_params_prefix(src, dst, src_size, 0, workmem, params, stats);
+}
+
+unsigned long
+lz4_pack_parser(const void *src, void *dst, unsigned long src_size,
+                void *workmem, int parser, int level)
+{
+	struct lz4_params params;
+
+	if (lz4_params_level(&params, parser, level) != 0) {
+		return LZ4_ERROR;
+	}
+
+	return lz4_pack_params(src, dst, src_size, workmem, &params);
+}
+
+size_t
+lz4_workmem_size_level(size_t src_size, int level)
+{
+	return lz4_workmem_size_parser(src_size, LZ4_PARSER_DEFAULT, level);
+}
+
 unsigned long
 lz4_pack_level(const void *src, void *dst, unsigned long src_size,
                void *workmem, int level)
 {
-	switch (level) {
-	case 5:
-		return lz4_pack_leparse(src, dst, src_size, workmem, 1, 18);
-	case 6:
-		return lz4_pack_leparse(src, dst, src_size, workmem, 8, 32);
-	case 7:
-		return lz4_pack_leparse(src, dst, src_size, workmem, 64, 64);
-	case 8:
-		return lz4_pack_btparse(src, dst, src_size, workmem, 16, 96);
-	case 9:
-		return lz4_pack_btparse(src, dst, src_size, workmem, 32, 224);
-	case 10:
-		return lz4_pack_btparse(src, dst, src_size, workmem, ULONG_MAX, ULONG_MAX);
-	default:
+	return lz4_pack_parser(src, dst, src_size, workmem, LZ4_PARSER_DEFAULT, level);
+}
+
+size_t
+lz4_workmem_size_params_dict(size_t src_size, const struct lz4_params *params)
+{
+	const size_t size = lz4_workmem_size_params(src_size + LZ4_DICT_SIZE_MAX, params);
+
+	if (size == (size_t) -1) {
+		return size;
+	}
+
+	// Room for copy of dictionary and input after workmem for parser
+	return size + src_size + LZ4_DICT_SIZE_MAX;
+}
+
+unsigned long
+lz4_pack_params_dict(const void *src, void *dst, unsigned long src_size,
+                     const void *dict, unsigned long dict_size,
+                     void *workmem, const struct lz4_params *params)
+{
+	return lz4_pack_params_dict_stats(src, dst, src_size, dict, dict_size,
+	                                  workmem, params, NULL);
+}
+
+unsigned long
+lz4_pack_params_dict_stats(const void *src, void *dst, unsigned long src_size,
+                           const void *dict, unsigned long dict_size,
+                           void *workmem, const struct lz4_params *params,
+                           struct lz4_pack_stats *stats)
+{
+	const unsigned char *buf = (const unsigned char *) src;
+
+	// Only the last LZ4_DICT_SIZE_MAX bytes can be reached by offsets
+	if (dict_size > LZ4_DICT_SIZE_MAX) {
+		dict = (const unsigned char *) dict + (dict_size - LZ4_DICT_SIZE_MAX);
+		dict_size = LZ4_DICT_SIZE_MAX;
+	}
+
+	// Place dictionary and input next to each other, unless they
+	// already are
+	if (dict_size > 0 && (const unsigned char *) dict + dict_size != buf) {
+		const size_t size = lz4_workmem_size_params(src_size + LZ4_DICT_SIZE_MAX, params);
+
+		if (size == (size_t) -1) {
+			return LZ4_ERROR;
+		}
+
+		unsigned char *copy = (unsigned char *) workmem + size;
+
+		memcpy(copy, dict, dict_size);
+		memcpy(copy + dict_size, src, src_size);
+
+		buf = copy;
+	}
+	else {
+		buf -= dict_size;
+	}
+
+	return lz4_pack_params_prefix(buf, dst, dict_size + src_size, dict_size,
+	                              workmem, params, stats);
+}
+
+size_t
+lz4_workmem_size_parser_dict(size_t src_size, int parser, int level)
+{
+	struct lz4_params params;
+
+	if (lz4_params_level(&params, parser, level) != 0) {
+		return (size_t) -1;
+	}
+
+	return lz4_workmem_size_params_dict(src_size, &params);
+}
+
+unsigned long
+lz4_pack_parser_dict(const void *src, void *dst, unsigned long src_size,
+                     const void *dict, unsigned long dict_size,
+                     void *workmem, int parser, int level)
+{
+	struct lz4_params params;
+
+	if (lz4_params_level(&params, parser, level) != 0) {
 		return LZ4_ERROR;
 	}
+
+	return lz4_pack_params_dict(src, dst, src_size, dict, dict_size, workmem, &params);
 }
 
-// clang -g -O1 -fsanitize=fuzzer,address -DLZ4_FUZZING lz4.c lz4_depack.c
+size_t
+lz4_workmem_size_level_dict(size_t src_size, int level)
+{
+	return lz4_workmem_size_parser_dict(src_size, LZ4_PARSER_DEFAULT, level);
+}
+
+unsigned long
+lz4_pack_level_dict(const void *src, void *dst, unsigned long src_size,
+                    const void *dict, unsigned long dict_size,
+                    void *workmem, int level)
+{
+	return lz4_pack_parser_dict(src, dst, src_size, dict, dict_size,
+	                            workmem, LZ4_PARSER_DEFAULT, level);
+}
+
+struct lz4_cctx {
+	void *workmem;
+	size_t workmem_size;
+	struct lz4_params params;
+};
+
+struct lz4_cctx *
+lz4_cctx_create(int parser, int level)
+{
+	struct lz4_cctx *ctx = (struct lz4_cctx *) malloc(sizeof(*ctx));
+
+	if (ctx == NULL) {
+		return NULL;
+	}
+
+	ctx->workmem = NULL;
+	ctx->workmem_size = 0;
+
+	if (lz4_cctx_reset(ctx, parser, level) != 0) {
+		free(ctx);
+		return NULL;
+	}
+
+	return ctx;
+}
+
+int
+lz4_cctx_reset(struct lz4_cctx *ctx, int parser, int level)
+{
+	struct lz4_params params;
+
+	if (lz4_params_level(&params, parser, level) != 0) {
+		return -1;
+	}
+
+	return lz4_cctx_set_params(ctx, &params);
+}
+
+int
+lz4_cctx_set_params(struct lz4_cctx *ctx, const struct lz4_params *params)
+{
+	if (!lz4_params_valid(params)) {
+		return -1;
+	}
+
+	ctx->params = *params;
+
+	return 0;
+}
+
+void
+lz4_cctx_free(struct lz4_cctx *ctx)
+{
+	if (ctx != NULL) {
+		free(ctx->workmem);
+		free(ctx);
+	}
+}
+
+unsigned long
+lz4_pack_ctx(struct lz4_cctx *ctx, const void *src, void *dst,
+             unsigned long src_size)
+{
+	const size_t size = lz4_workmem_size_params(src_size, &ctx->params);
+
+	// Grow workmem if needed, the contents need not be kept
+	if (size > ctx->workmem_size) {
+		free(ctx->workmem);
+
+		ctx->workmem_size = 0;
+
+		if ((ctx->workmem = malloc(size)) == NULL) {
+			return LZ4_ERROR;
+		}
+
+		ctx->workmem_size = size;
+	}
+
+	return lz4_pack_params(src, dst, src_size, ctx->workmem, &ctx->params);
+}
+
+// clang -g -O1 -fsanitize=fuzzer,address -DLZ4_FUZZING -c lz4.c
+// clang -g -O1 -fsanitize=fuzzer,address lz4.o lz4_depack.c lz4_kernels.c
+//
+// Only define LZ4_FUZZING for the file with the fuzz target, since
+// lz4_depack.c and lz4_reader.c have their own.
 #if defined(LZ4_FUZZING)
 #include <limits.h>
 #include <stddef.h>
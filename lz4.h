@@ -69,6 +69,99 @@ extern "C" {
 #  define LZ4_ERROR ((unsigned long) (-1))
 #endif
 
+/**
+ * Parsers that can be selected with lz4_pack_parser.
+ */
+#define LZ4_PARSER_DEFAULT 0 /**< Parser used by level */
+#define LZ4_PARSER_FAST    1 /**< Greedy parse, single-probe hash table */
+#define LZ4_PARSER_LAZY    2 /**< Lazy parse, hash chains */
+#define LZ4_PARSER_LEPARSE 3 /**< Backwards DP parse with left-extension */
+#define LZ4_PARSER_SSPARSE 4 /**< Backwards DP parse */
+#define LZ4_PARSER_BTPARSE 5 /**< Forwards DP parse, binary trees */
+#define LZ4_PARSER_SAPARSE 6 /**< Forwards DP parse, suffix array */
+
+/**
+ * Parser and search parameters for lz4_pack_params.
+ *
+ * lz4_params_level gets the parameters used by a parser at a compression
+ * level, which can then be adjusted.
+ *
+ * For `LZ4_PARSER_FAST`, `hash_bits` is the maximum, `max_depth` is not
+ * used, and `accept_len` is the acceleration, the initial step size when
+ * there are no matches. `LZ4_PARSER_LAZY` checks up to `max_depth`
+ * matches of eight bytes or more, but only `max_depth` / 8 of four bytes.
+ * `LZ4_PARSER_LEPARSE` and `LZ4_PARSER_SSPARSE` use at most log2 of the
+ * input size bits of hash. `LZ4_PARSER_SAPARSE` uses only `hash_bits`
+ * and `window_size`, since it searches every match.
+ */
+struct lz4_params {
+	int parser;                /**< One of the `LZ4_PARSER_` values */
+	int hash_bits;             /**< Bits of hash for lookup, 8 to 24 */
+	unsigned long max_depth;   /**< Maximum matches checked per position */
+	unsigned long accept_len;  /**< Match length to take without search */
+	unsigned long window_size; /**< Maximum offset, 1 to 65535 */
+};
+
+/**
+ * Statistics gathered by lz4_pack_params_stats.
+ *
+ * Only `LZ4_PARSER_LEPARSE` and `LZ4_PARSER_BTPARSE` gather statistics,
+ * other parsers leave them unchanged. leparse searches for matches while
+ * finding the lowest cost path, so its search time is part of
+ * `time_parse`.
+ */
+struct lz4_pack_stats {
+	double time_build;                 /**< Seconds setting up match finder */
+	double time_search;                /**< Seconds searching for matches */
+	double time_parse;                 /**< Seconds finding lowest cost path */
+	double time_emit;                  /**< Seconds writing compressed data */
+	unsigned long long nodes_visited;  /**< Hash chain or tree nodes visited */
+	unsigned long long bytes_compared; /**< Bytes compared extending matches */
+	unsigned long long accept_cutoffs; /**< Searches stopped by `accept_len` */
+};
+
+/**
+ * Maximum number of bytes of dictionary used by lz4_pack_level_dict and
+ * lz4_depack_dict.
+ */
+#define LZ4_DICT_SIZE_MAX 65536
+
+/**
+ * Number of bytes past the end of the decompressed data that
+ * lz4_depack_fast may overwrite.
+ */
+#define LZ4_DEPACK_FAST_SLACK 16
+
+/**
+ * Magic of skippable frame holding seek index.
+ *
+ * The seek index is a skippable frame at the end of the file, which
+ * lz4_reader_open uses to find blocks. Its data is an entry for each
+ * block, holding the offset of the block in the decompressed data and the
+ * offset of its block header in the file, as 64-bit little-endian values,
+ * followed by a trailer of:
+ *
+ *   - size of decompressed data (64-bit)
+ *   - number of blocks (32-bit)
+ *   - maximum size of decompressed block (32-bit)
+ *   - `LZ4_INDEX_` flags (32-bit)
+ *   - `LZ4_INDEX_ID` (32-bit)
+ */
+#define LZ4_INDEX_MAGIC (0x184D2A5BUL)
+#define LZ4_INDEX_ID (0x58444942UL)     /**< "BIDX" */
+#define LZ4_INDEX_ENTRY_SIZE 16         /**< Size of index entry */
+#define LZ4_INDEX_TRAILER_SIZE 24       /**< Size of index trailer */
+#define LZ4_INDEX_FRAME_BLOCKS 1        /**< Blocks are LZ4 frame blocks */
+#define LZ4_INDEX_BLOCK_CHECKSUM 2      /**< Blocks have checksums */
+
+/**
+ * Kernels that can be selected with lz4_set_kernel.
+ */
+#define LZ4_KERNEL_AUTO   0 /**< Best kernel supported by the CPU */
+#define LZ4_KERNEL_SCALAR 1 /**< Portable C */
+#define LZ4_KERNEL_SSE2   2 /**< x86 SSE2 */
+#define LZ4_KERNEL_AVX2   3 /**< x86 AVX2 */
+
 /**
  * Get bound on compressed data size.
  *
@@ -95,8 +188,10 @@ lz4_workmem_size_level(size_t src_size, int level);
 /**
  * Compress `src_size` bytes of data from `src` to `dst`.
  *
- * Compression levels between 5 and 9 offer a trade-off between
- * time/space and ratio. Level 10 is optimal but very slow.
+ * Compression levels 1 to 4 use a fast greedy parse with small workmem.
+ * Levels between 5 and 9 offer a trade-off between time/space and ratio.
+ * Level 10 is optimal but slow. The lazy parse, `LZ4_PARSER_LAZY`, is
+ * not used by any level, but can be selected with `lz4_pack_parser`.
  *
  * @param src pointer to data
  * @param dst pointer to where to place compressed data
@@ -109,6 +204,311 @@ LZ4_API unsigned long
 lz4_pack_level(const void *src, void *dst, unsigned long src_size,
                void *workmem, int level);
 
+/**
+ * Get required size of `workmem` buffer for `parser`.
+ *
+ * @see lz4_pack_parser
+ *
+ * @param src_size number of bytes to compress
+ * @param parser parser to use, one of the `LZ4_PARSER_` values
+ * @param level compression level
+ * @return required size in bytes of `workmem` buffer
+ */
+LZ4_API size_t
+lz4_workmem_size_parser(size_t src_size, int parser, int level);
+
+/**
+ * Compress `src_size` bytes of data from `src` to `dst` using `parser`.
+ *
+ * The level selects the search parameters for the parser. With
+ * `LZ4_PARSER_DEFAULT` this is the same as `lz4_pack_level`.
+ *
+ * @param src pointer to data
+ * @param dst pointer to where to place compressed data
+ * @param src_size number of bytes to compress
+ * @param workmem pointer to memory for temporary use
+ * @param parser parser to use, one of the `LZ4_PARSER_` values
+ * @param level compression level
+ * @return size of compressed data
+ */
+LZ4_API unsigned long
+lz4_pack_parser(const void *src, void *dst, unsigned long src_size,
+                void *workmem, int parser, int level);
+
+/**
+ * Get required size of `workmem` buffer for dictionary compression.
+ *
+ * @see lz4_pack_level_dict
+ *
+ * @param src_size number of bytes to compress
+ * @param level compression level
+ * @return required size in bytes of `workmem` buffer
+ */
+LZ4_API size_t
+lz4_workmem_size_level_dict(size_t src_size, int level);
+
+/**
+ * Compress `src_size` bytes of data from `src` to `dst` using a dictionary.
+ *
+ * The dictionary is data assumed to precede `src`, which matches may
+ * refer to. Only the last `LZ4_DICT_SIZE_MAX` bytes of the dictionary
+ * are used. The same dictionary must be passed to lz4_depack_dict to
+ * decompress the data.
+ *
+ * If `dict` ends where `src` starts, the data is used in place, otherwise
+ * it is copied to `workmem`.
+ *
+ * @param src pointer to data
+ * @param dst pointer to where to place compressed data
+ * @param src_size number of bytes to compress
+ * @param dict pointer to dictionary
+ * @param dict_size size of dictionary
+ * @param workmem pointer to memory for temporary use
+ * @param level compression level
+ * @return size of compressed data
+ */
+LZ4_API unsigned long
+lz4_pack_level_dict(const void *src, void *dst, unsigned long src_size,
+                    const void *dict, unsigned long dict_size,
+                    void *workmem, int level);
+
+/**
+ * Get required size of `workmem` buffer for dictionary compression with
+ * `parser`.
+ *
+ * @see lz4_pack_parser_dict
+ *
+ * @param src_size number of bytes to compress
+ * @param parser parser to use, one of the `LZ4_PARSER_` values
+ * @param level compression level
+ * @return required size in bytes of `workmem` buffer
+ */
+LZ4_API size_t
+lz4_workmem_size_parser_dict(size_t src_size, int parser, int level);
+
+/**
+ * Compress `src_size` bytes of data from `src` to `dst` using a dictionary
+ * and `parser`.
+ *
+ * @see lz4_pack_level_dict
+ * @see lz4_pack_parser
+ *
+ * @param src pointer to data
+ * @param dst pointer to where to place compressed data
+ * @param src_size number of bytes to compress
+ * @param dict pointer to dictionary
+ * @param dict_size size of dictionary
+ * @param workmem pointer to memory for temporary use
+ * @param parser parser to use, one of the `LZ4_PARSER_` values
+ * @param level compression level
+ * @return size of compressed data
+ */
+LZ4_API unsigned long
+lz4_pack_parser_dict(const void *src, void *dst, unsigned long src_size,
+                     const void *dict, unsigned long dict_size,
+                     void *workmem, int parser, int level);
+
+/**
+ * Get parameters used by `parser` at `level`.
+ *
+ * @see lz4_pack_params
+ *
+ * @param params pointer to where to store parameters
+ * @param parser parser to use, one of the `LZ4_PARSER_` values
+ * @param level compression level
+ * @return 0 on success, -1 if the combination is not valid
+ */
+LZ4_API int
+lz4_params_level(struct lz4_params *params, int parser, int level);
+
+/**
+ * Get required size of `workmem` buffer for `params`.
+ *
+ * @see lz4_pack_params
+ *
+ * @param src_size number of bytes to compress
+ * @param params pointer to parameters
+ * @return required size in bytes of `workmem` buffer, `(size_t) -1` if
+ *         the parameters are not valid
+ */
+LZ4_API size_t
+lz4_workmem_size_params(size_t src_size, const struct lz4_params *params);
+
+/**
+ * Compress `src_size` bytes of data from `src` to `dst` using `params`.
+ *
+ * @see lz4_params_level
+ *
+ * @param src pointer to data
+ * @param dst pointer to where to place compressed data
+ * @param src_size number of bytes to compress
+ * @param workmem pointer to memory for temporary use
+ * @param params pointer to parameters
+ * @return size of compressed data, `LZ4_ERROR` if the parameters are not
+ *         valid
+ */
+LZ4_API unsigned long
+lz4_pack_params(const void *src, void *dst, unsigned long src_size,
+                void *workmem, const struct lz4_params *params);
+
+/**
+ * Compress `src_size` bytes of data from `src` to `dst` using `params`,
+ * gathering statistics.
+ *
+ * The statistics are added to those in `stats`, so it should be zeroed
+ * before the first call. Gathering them takes a little time, so use
+ * lz4_pack_params when they are not needed.
+ *
+ * @see lz4_pack_params
+ *
+ * @param src pointer to data
+ * @param dst pointer to where to place compressed data
+ * @param src_size number of bytes to compress
+ * @param workmem pointer to memory for temporary use
+ * @param params pointer to parameters
+ * @param stats pointer to statistics to add to
+ * @return size of compressed data, `LZ4_ERROR` if the parameters are not
+ *         valid
+ */
+LZ4_API unsigned long
+lz4_pack_params_stats(const void *src, void *dst, unsigned long src_size,
+                      void *workmem, const struct lz4_params *params,
+                      struct lz4_pack_stats *stats);
+
+/**
+ * Get required size of `workmem` buffer for dictionary compression with
+ * `params`.
+ *
+ * @see lz4_pack_params_dict
+ *
+ * @param src_size number of bytes to compress
+ * @param params pointer to parameters
+ * @return required size in bytes of `workmem` buffer, `(size_t) -1` if
+ *         the parameters are not valid
+ */
+LZ4_API size_t
+lz4_workmem_size_params_dict(size_t src_size, const struct lz4_params *params);
+
+/**
+ * Compress `src_size` bytes of data from `src` to `dst` using a dictionary
+ * and `params`.
+ *
+ * @see lz4_pack_level_dict
+ * @see lz4_pack_params
+ *
+ * @param src pointer to data
+ * @param dst pointer to where to place compressed data
+ * @param src_size number of bytes to compress
+ * @param dict pointer to dictionary
+ * @param dict_size size of dictionary
+ * @param workmem pointer to memory for temporary use
+ * @param params pointer to parameters
+ * @return size of compressed data, `LZ4_ERROR` if the parameters are not
+ *         valid
+ */
+LZ4_API unsigned long
+lz4_pack_params_dict(const void *src, void *dst, unsigned long src_size,
+                     const void *dict, unsigned long dict_size,
+                     void *workmem, const struct lz4_params *params);
+
+/**
+ * Compress `src_size` bytes of data from `src` to `dst` using a dictionary
+ * and `params`, gathering statistics.
+ *
+ * @see lz4_pack_params_dict
+ * @see lz4_pack_params_stats
+ *
+ * @param src pointer to data
+ * @param dst pointer to where to place compressed data
+ * @param src_size number of bytes to compress
+ * @param dict pointer to dictionary
+ * @param dict_size size of dictionary
+ * @param workmem pointer to memory for temporary use
+ * @param params pointer to parameters
+ * @param stats pointer to statistics to add to
+ * @return size of compressed data, `LZ4_ERROR` if the parameters are not
+ *         valid
+ */
+LZ4_API unsigned long
+lz4_pack_params_dict_stats(const void *src, void *dst, unsigned long src_size,
+                           const void *dict, unsigned long dict_size,
+                           void *workmem, const struct lz4_params *params,
+                           struct lz4_pack_stats *stats);
+
+/**
+ * Compression context.
+ *
+ * Holds the parameters and workmem for compressing, where workmem grows
+ * as needed, so compressing many inputs does not allocate memory for
+ * each.
+ *
+ * For inputs of a few KiB or less, levels above 6 give no better ratio
+ * than level 6 at several times the cost.
+ *
+ * A context must not be used by several threads at the same time.
+ */
+struct lz4_cctx;
+
+/**
+ * Create compression context for `parser` at `level`.
+ *
+ * @see lz4_pack_ctx
+ *
+ * @param parser parser to use, one of the `LZ4_PARSER_` values
+ * @param level compression level
+ * @return pointer to context, `NULL` on error or if the combination of
+ *         parser and level is not valid
+ */
+LZ4_API struct lz4_cctx *
+lz4_cctx_create(int parser, int level);
+
+/**
+ * Change the parser and level of compression context, keeping its memory.
+ *
+ * @param ctx pointer to context
+ * @param parser parser to use, one of the `LZ4_PARSER_` values
+ * @param level compression level
+ * @return 0 on success, -1 if the combination of parser and level is not
+ *         valid, in which case the context is unchanged
+ */
+LZ4_API int
+lz4_cctx_reset(struct lz4_cctx *ctx, int parser, int level);
+
+/**
+ * Change the parameters of compression context, keeping its memory.
+ *
+ * @param ctx pointer to context
+ * @param params pointer to parameters
+ * @return 0 on success, -1 if the parameters are not valid, in which case
+ *         the context is unchanged
+ */
+LZ4_API int
+lz4_cctx_set_params(struct lz4_cctx *ctx, const struct lz4_params *params);
+
+/**
+ * Free compression context.
+ *
+ * @param ctx pointer to context, may be `NULL`
+ */
+LZ4_API void
+lz4_cctx_free(struct lz4_cctx *ctx);
+
+/**
+ * Compress `src_size` bytes of data from `src` to `dst` using context.
+ *
+ * The result is the same as `lz4_pack_params` with the parameters of the
+ * context.
+ *
+ * @param ctx pointer to context
+ * @param src pointer to data
+ * @param dst pointer to where to place compressed data
+ * @param src_size number of bytes to compress
+ * @return size of compressed data, `LZ4_ERROR` if out of memory
+ */
+LZ4_API unsigned long
+lz4_pack_ctx(struct lz4_cctx *ctx, const void *src, void *dst,
+             unsigned long src_size);
+
 /**
  * Decompress data from `src` to `dst`.
  *
@@ -120,6 +520,286 @@ lz4_pack_level(const void *src, void *dst, unsigned long src_size,
 LZ4_API unsigned long
 lz4_depack(const void *src, void *dst, unsigned long packed_size);
 
+/**
+ * Decompress data from `src` to `dst`, using wild copies.
+ *
+ * Literals and matches are copied in chunks of 8 and 16 bytes, which may
+ * write past their end, with the last bytes of the data decompressed
+ * exactly. This is considerably faster than lz4_depack, but `dst` must
+ * have room for `LZ4_DEPACK_FAST_SLACK` bytes past the decompressed data.
+ *
+ * Like lz4_depack, this does not validate the compressed data.
+ *
+ * @see lz4_depack
+ *
+ * @param src pointer to compressed data
+ * @param dst pointer to where to place decompressed data
+ * @param packed_size size of compressed data
+ * @return size of decompressed data
+ */
+LZ4_API unsigned long
+lz4_depack_fast(const void *src, void *dst, unsigned long packed_size);
+
+/**
+ * Decompress data from `src` to `dst` using a dictionary.
+ *
+ * @see lz4_pack_level_dict
+ *
+ * @param src pointer to compressed data
+ * @param dst pointer to where to place decompressed data
+ * @param packed_size size of compressed data
+ * @param dict pointer to dictionary used when compressing
+ * @param dict_size size of dictionary
+ * @return size of decompressed data, `LZ4_ERROR` on error
+ */
+LZ4_API unsigned long
+lz4_depack_dict(const void *src, void *dst, unsigned long packed_size,
+                const void *dict, unsigned long dict_size);
+
+/**
+ * Decompress data from `src` to `dst`, validating the compressed data.
+ *
+ * Unlike lz4_depack, this never reads outside `src`, writes outside `dst`,
+ * or follows offsets to before the start of `dst`, so it can be used on
+ * data that may be corrupt or from untrusted sources. It uses wild copies
+ * like lz4_depack_fast where there is room, but needs no slack.
+ *
+ * @param src pointer to compressed data
+ * @param dst pointer to where to place decompressed data
+ * @param packed_size size of compressed data
+ * @param dst_capacity size of `dst` buffer
+ * @return size of decompressed data, `LZ4_ERROR` on error
+ */
+LZ4_API unsigned long
+lz4_depack_safe(const void *src, void *dst, unsigned long packed_size,
+                unsigned long dst_capacity);
+
+/**
+ * Decompress data from `src` to `dst` using a dictionary, validating the
+ * compressed data.
+ *
+ * @see lz4_depack_safe
+ * @see lz4_depack_dict
+ *
+ * @param src pointer to compressed data
+ * @param dst pointer to where to place decompressed data
+ * @param packed_size size of compressed data
+ * @param dst_capacity size of `dst` buffer
+ * @param dict pointer to dictionary used when compressing
+ * @param dict_size size of dictionary
+ * @return size of decompressed data, `LZ4_ERROR` on error
+ */
+LZ4_API unsigned long
+lz4_depack_safe_dict(const void *src, void *dst, unsigned long packed_size,
+                     unsigned long dst_capacity,
+                     const void *dict, unsigned long dict_size);
+
+/**
+ * Decompress the first `target_size` bytes of data from `src` to `dst`.
+ *
+ * Decompression stops once `target_size` bytes have been produced, so
+ * only the sequences needed for them are decoded, and `dst` only needs
+ * room for `target_size` bytes. The compressed data is validated like
+ * with lz4_depack_safe, up to where decompression stops.
+ *
+ * To get a range of the decompressed data, decompress up to its end,
+ * since matches may refer to any of the data before it.
+ *
+ * @see lz4_depack_safe
+ *
+ * @param src pointer to compressed data
+ * @param dst pointer to where to place decompressed data
+ * @param packed_size size of compressed data
+ * @param target_size number of bytes to decompress
+ * @return number of bytes decompressed, which is less than `target_size`
+ *         only if the decompressed data is smaller, `LZ4_ERROR` on error
+ */
+LZ4_API unsigned long
+lz4_depack_partial(const void *src, void *dst, unsigned long packed_size,
+                   unsigned long target_size);
+
+/**
+ * State for computing xxHash32 of data in pieces.
+ *
+ * @see lz4_xxh32_init
+ */
+struct lz4_xxh32_state {
+	unsigned long acc[4];
+	unsigned long seed;
+	unsigned long long total_len;
+	unsigned char buf[16];
+	size_t buf_size;
+};
+
+/**
+ * Compute xxHash32 of `size` bytes of data from `data`.
+ *
+ * This is the checksum used for the header, blocks and content of the
+ * LZ4 frame format, which use a seed of zero.
+ *
+ * @param data pointer to data
+ * @param size number of bytes of data
+ * @param seed seed value
+ * @return 32-bit hash value
+ */
+LZ4_API unsigned long
+lz4_xxh32(const void *data, size_t size, unsigned long seed);
+
+/**
+ * Initialize `state` for computing xxHash32 of data in pieces.
+ *
+ * @param state pointer to state
+ * @param seed seed value
+ */
+LZ4_API void
+lz4_xxh32_init(struct lz4_xxh32_state *state, unsigned long seed);
+
+/**
+ * Add `size` bytes of data from `data` to `state`.
+ *
+ * @param state pointer to state
+ * @param data pointer to data
+ * @param size number of bytes of data
+ */
+LZ4_API void
+lz4_xxh32_update(struct lz4_xxh32_state *state, const void *data, size_t size);
+
+/**
+ * Get xxHash32 of data added to `state` so far.
+ *
+ * The state is not modified, so more data may be added afterwards.
+ *
+ * @param state pointer to state
+ * @return 32-bit hash value
+ */
+LZ4_API unsigned long
+lz4_xxh32_digest(const struct lz4_xxh32_state *state);
+
+/**
+ * Select kernels used for match search and copying.
+ *
+ * By default, the best kernels supported by the CPU are selected on first
+ * use. This function can be used to force a specific set of kernels, for
+ * instance for benchmarking.
+ *
+ * This is not thread-safe, it should be called before compressing or
+ * decompressing data.
+ *
+ * @param kernel kernel to use, one of the `LZ4_KERNEL_` values
+ * @return kernel selected, or -1 if `kernel` is not supported
+ */
+LZ4_API int
+lz4_set_kernel(int kernel);
+
+/**
+ * Get kernels in use.
+ *
+ * @return kernel in use, one of the `LZ4_KERNEL_` values except
+ * `LZ4_KERNEL_AUTO`
+ */
+LZ4_API int
+lz4_get_kernel(void);
+
+/**
+ * Get name of kernel.
+ *
+ * @param kernel one of the `LZ4_KERNEL_` values
+ * @return name of kernel, or `NULL` if not valid
+ */
+LZ4_API const char *
+lz4_kernel_name(int kernel);
+
+/**
+ * Reader for random access to compressed file with seek index.
+ *
+ * A reader may be used from several threads at the same time.
+ *
+ * @see lz4_reader_open
+ */
+struct lz4_reader;
+
+/**
+ * Statistics of block cache of reader.
+ *
+ * @see lz4_reader_get_stats
+ */
+struct lz4_reader_stats {
+	unsigned long long hits;      /**< Blocks found in cache */
+	unsigned long long misses;    /**< Blocks read and decompressed */
+	unsigned long long evictions; /**< Blocks removed from cache */
+};
+
+/**
+ * Open compressed file `filename` for random access.
+ *
+ * The file must end with a seek index, like the one written by
+ * `blz4 --index`. Blocks may be in legacy format, or in LZ4 frames with
+ * independent blocks.
+ *
+ * The reader keeps up to `cache_blocks` decompressed blocks in a cache,
+ * replacing the least recently used block when it is full. Each uses
+ * memory for the maximum block size of the file. If `cache_blocks` is
+ * zero, each read decompresses the blocks it needs, and only as much of
+ * them as needed.
+ *
+ * Reads that miss the cache at the same time each use their own handle
+ * to the file and buffers, which are kept open until the reader is
+ * closed.
+ *
+ * @see LZ4_INDEX_MAGIC
+ *
+ * @param filename name of file
+ * @param cache_blocks maximum number of blocks in cache
+ * @return pointer to reader, `NULL` on error or if there is no index
+ */
+LZ4_API struct lz4_reader *
+lz4_reader_open(const char *filename, unsigned long cache_blocks);
+
+/**
+ * Close reader and free the memory it uses.
+ *
+ * @param reader pointer to reader, may be `NULL`
+ */
+LZ4_API void
+lz4_reader_close(struct lz4_reader *reader);
+
+/**
+ * Get size of decompressed data of reader.
+ *
+ * @param reader pointer to reader
+ * @return size of decompressed data
+ */
+LZ4_API unsigned long long
+lz4_reader_size(const struct lz4_reader *reader);
+
+/**
+ * Get statistics of block cache of reader.
+ *
+ * @param reader pointer to reader
+ * @param stats pointer to where to store statistics
+ */
+LZ4_API void
+lz4_reader_get_stats(struct lz4_reader *reader, struct lz4_reader_stats *stats);
+
+/**
+ * Read `size` bytes of decompressed data starting at `offset` into `dst`.
+ *
+ * Like `pread`, this does not depend on any position in the reader, so
+ * several threads may read from it at the same time. Only the blocks
+ * covering the range are used, and those not in the cache are read and
+ * decompressed.
+ *
+ * @param reader pointer to reader
+ * @param dst pointer to where to place decompressed data
+ * @param offset offset in decompressed data
+ * @param size number of bytes to read
+ * @return number of bytes read, which is less than `size` only at the
+ *         end of the data, `LZ4_ERROR` on error
+ */
+LZ4_API unsigned long
+lz4_reader_read(struct lz4_reader *reader, void *dst,
+                unsigned long long offset, unsigned long size);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -28,349 +28,593 @@
 #ifndef LZ4_BTPARSE_H_INCLUDED
 #define LZ4_BTPARSE_H_INCLUDED
 
+// Number of positions in the sliding window of tree nodes.
+//
+// This must be a power of two larger than the largest window size, so a
+// node is only reused once its position can no longer be matched.
+//
+#define LZ4_BTPARSE_WINDOW_SIZE (1UL << 16)
+
+// Number of positions the dynamic programming parse works on at a time.
+//
+// The parse is optimal within each chunk, so larger values give slightly
+// better ratio on large inputs, at the cost of 5 words of workmem per
+// position.
+//
+#ifndef LZ4_BTPARSE_CHUNK_SIZE
+#  define LZ4_BTPARSE_CHUNK_SIZE (1UL << 18)
+#endif
+
+// Number of positions at the end of a chunk that are parsed again as part
+// of the next chunk, because the lowest cost path there depends on what
+// follows.
+//
+#define LZ4_BTPARSE_CHUNK_OVERLAP (LZ4_BTPARSE_CHUNK_SIZE / 16)
+
+static unsigned long
+lz4_btparse_chunk_size(size_t src_size)
+{
+	return src_size < LZ4_BTPARSE_CHUNK_SIZE ? (unsigned long) src_size : LZ4_BTPARSE_CHUNK_SIZE;
+}
+
+static unsigned long
+lz4_btparse_window_size(size_t src_size)
+{
+	return src_size < LZ4_BTPARSE_WINDOW_SIZE ? (unsigned long) src_size : LZ4_BTPARSE_WINDOW_SIZE;
+}
+
 static size_t
-lz4_btparse_workmem_size(size_t src_size)
+lz4_btparse_workmem_size(size_t src_size, int hash_bits)
 {
-	return (5 * src_size + 3 + LOOKUP_SIZE) * sizeof(uint32_t);
+	return (5 * lz4_btparse_chunk_size(src_size) + 3
+	      + 2 * lz4_btparse_window_size(src_size)
+	      + (1UL << lz4_lookup_bits(src_size, hash_bits))) * sizeof(uint32_t);
 }
 
-// Forwards dynamic programming parse using binary trees, checking all
-// possible matches.
+// Insert position cur into the binary trees, searching for matches.
 //
-// The match search uses a binary tree for each hash entry, which is updated
+// Returns the length of the longest match and stores its position in
+// match_pos, or returns 0 if there is no match or we are not checking
+// matches at cur.
+//
+// The search uses a binary tree for each hash entry, which is updated
 // dynamically as it is searched by re-rooting the tree at the search string.
 //
 // This does not result in balanced trees on all inputs, but often works well
 // in practice, and has the advantage that we get the matches in order from
 // closest and back.
 //
-// A drawback is the memory requirement of 5 * src_size words, since we cannot
-// overlap the arrays in a forwards parse.
+// The nodes are kept in a sliding window indexed by position modulo
+// LZ4_BTPARSE_WINDOW_SIZE. Since the search stops at the first position
+// that is too far back to match, we never follow a link into a node that
+// has been reused.
 //
 // This match search method is found in LZMA by Igor Pavlov, libdeflate
 // by Eric Biggers, and other libraries.
 //
+// The counters of counts are updated with the work done.
+//
 static unsigned long
-lz4_pack_btparse(const void *src, void *dst, unsigned long src_size, void *workmem,
-                 const unsigned long max_depth, const unsigned long accept_len)
+lz4_btparse_insert(const unsigned char *in, unsigned long src_size, unsigned long cur,
+                   uint32_t *nodes, uint32_t *lookup, int bits, const struct lz4_params *params,
+                   unsigned long *next_match_cur, unsigned long *match_pos,
+                   struct lz4_pack_stats *counts)
+{
+	const unsigned long window_mask = LZ4_BTPARSE_WINDOW_SIZE - 1;
+	const unsigned long accept_len = params->accept_len;
+
+	if (cur > *next_match_cur) {
+		*next_match_cur = cur;
+	}
+
+	const int checking = cur == *next_match_cur;
+
+	unsigned long max_len = 3;
+	unsigned long max_len_pos = NO_MATCH_POS;
+
+	// Look up first match for current position
+	//
+	// pos is the current root of the tree of strings with this
+	// hash. We are going to re-root the tree so cur becomes the
+	// new root.
+	//
+	const unsigned long hash = lz4_hash4_bits(&in[cur], bits);
+	unsigned long pos = lookup[hash];
+	lookup[hash] = cur;
+
+	uint32_t *lt_node = &nodes[2 * (cur & window_mask)];
+	uint32_t *gt_node = &nodes[2 * (cur & window_mask) + 1];
+	unsigned long lt_len = 0;
+	unsigned long gt_len = 0;
+
+	assert(pos == NO_MATCH_POS || pos < cur);
+
+	// If we are checking matches, allow lengths up to end of
+	// input, otherwise compare only up to accept_len
+	const unsigned long len_limit = checking ? src_size - cur - 5
+	                              : accept_len < src_size - cur - 5 ? accept_len
+	                              : src_size - cur - 5;
+	unsigned long num_chain = params->max_depth;
+
+	// Check matches
+	for (;;) {
+		// If at bottom of tree, mark leaf nodes
+		//
+		// In case we reached max_depth, this also prunes the
+		// subtree we have not searched yet and do not know
+		// where belongs.
+		//
+		if (pos == NO_MATCH_POS || cur - pos > params->window_size || num_chain-- == 0) {
+			*lt_node = NO_MATCH_POS;
+			*gt_node = NO_MATCH_POS;
+
+			break;
+		}
+
+		// The string at pos is lexicographically greater than
+		// a string that matched in the first lt_len positions,
+		// and less than a string that matched in the first
+		// gt_len positions, so it must match up to at least
+		// the minimum of these.
+		const unsigned long min_len = lt_len < gt_len ? lt_len : gt_len;
+
+		// Find match len
+		const unsigned long len = lz4_match_len(&in[pos], &in[cur], min_len, len_limit);
+
+		++counts->nodes_visited;
+		counts->bytes_compared += len - min_len;
+
+		// Update longest match found
+		if (checking && len > max_len) {
+			max_len = len;
+			max_len_pos = pos;
+
+			if (len >= accept_len) {
+				*next_match_cur = cur + len;
+			}
+		}
+
+		uint32_t *const pos_node = &nodes[2 * (pos & window_mask)];
+
+		// If we reach maximum match length, the string at pos
+		// is equal to cur, so we can assign the left and right
+		// subtrees.
+		//
+		// This removes pos from the tree, but we added cur
+		// which is equal and closer for future matches.
+		//
+		if (len >= accept_len || len == len_limit) {
+			*lt_node = pos_node[0];
+			*gt_node = pos_node[1];
+
+			counts->accept_cutoffs += checking && len < len_limit;
+
+			break;
+		}
+
+		// Go to previous match and restructure tree
+		//
+		// lt_node points to a node that is going to contain
+		// elements lexicographically less than cur (the search
+		// string).
+		//
+		// If the string at pos is less than cur, we set that
+		// lt_node to pos. We know that all elements in the
+		// left subtree are less than pos, and thus less than
+		// cur, so we point lt_node at the right subtree of
+		// pos and continue our search there.
+		//
+		// The equivalent applies to gt_node when the string at
+		// pos is greater than cur.
+		//
+		if (in[pos + len] < in[cur + len]) {
+			*lt_node = pos;
+			lt_node = &pos_node[1];
+			assert(*lt_node == NO_MATCH_POS || *lt_node < pos);
+			pos = *lt_node;
+			lt_len = len;
+		}
+		else {
+			*gt_node = pos;
+			gt_node = &pos_node[0];
+			assert(*gt_node == NO_MATCH_POS || *gt_node < pos);
+			pos = *gt_node;
+			gt_len = len;
+		}
+	}
+
+	if (max_len_pos == NO_MATCH_POS) {
+		return 0;
+	}
+
+	*match_pos = max_len_pos;
+
+	return max_len;
+}
+
+// Forwards dynamic programming parse using binary trees, checking all
+// possible matches.
+//
+// A forwards parse cannot overlap its arrays, so to keep memory bounded on
+// large inputs, the parse works on chunks of LZ4_BTPARSE_CHUNK_SIZE
+// positions. The lowest cost path through a chunk is found, and the tokens
+// on it are output, except for the last LZ4_BTPARSE_CHUNK_OVERLAP positions,
+// where the next chunk continues from, carrying over any pending literals.
+// Matches are limited to the end of the chunk.
+//
+// The longest match found at each position is saved, so the positions that
+// are parsed again are not inserted into the trees twice. Inputs no larger
+// than a chunk are parsed in one go, with the same result as a parse over
+// the whole input.
+//
+// If the trees do more than max_work work per position on average,
+// counting each node visited and each 64 bytes compared, we stop and
+// return LZ4_ERROR. The average is over the input up to the current
+// position, with LZ4_BTPARSE_WINDOW_SIZE positions of slack, so a burst
+// of work on a few repeated strings does not stop the search. This lets
+// saparse try the trees first, and switch to the suffix array on data
+// where they degenerate.
+//
+static unsigned long
+lz4_pack_btparse(const void *src, void *dst, unsigned long src_size,
+                 unsigned long dict_size, void *workmem,
+                 const struct lz4_params *params, struct lz4_pack_stats *stats,
+                 unsigned long max_work)
 {
 	const unsigned char *const in = (const unsigned char *) src;
 	const unsigned long last_match_pos = src_size > 12 ? src_size - 12 : 0;
+	const unsigned long accept_len = params->accept_len;
 
 	// Check for empty input
-	if (src_size == 0) {
+	if (src_size == dict_size) {
 		unsigned char *out = (unsigned char *) dst;
 		*out++ = 0;
 		return 1;
 	}
 
 	// Check for input without room for match
-	if (src_size < 13) {
+	if (src_size - dict_size < 13) {
 		unsigned char *out = (unsigned char *) dst;
-		*out++ = src_size << 4;
-		for (unsigned long i = 0; i < src_size; ++i) {
+		*out++ = (src_size - dict_size) << 4;
+		for (unsigned long i = dict_size; i < src_size; ++i) {
 			*out++ = in[i];
 		}
-		return 1 + src_size;
+		return 1 + src_size - dict_size;
 	}
 
-	uint32_t *const cost = (uint32_t *) workmem;
-	uint32_t *const mpos = cost + src_size + 1;
-	uint32_t *const mlen = mpos + src_size + 1;
-	uint32_t *const nodes = mlen + src_size + 1;
-	uint32_t *const lookup = nodes + 2 * src_size;
+	// Counters and times for stats
+	struct lz4_pack_stats counts = { 0.0, 0.0, 0.0, 0.0, 0, 0, 0 };
+
+	double time_start = lz4_stats_time(stats);
+
+	const unsigned long chunk_size = lz4_btparse_chunk_size(src_size);
+
+	const int bits = lz4_lookup_bits(src_size, params->hash_bits);
+
+	uint32_t *const lookup = (uint32_t *) workmem;
+	uint32_t *const cost = lookup + (1UL << bits);
+	uint32_t *const mpos = cost + chunk_size + 1;
+	uint32_t *const mlen = mpos + chunk_size + 1;
+	uint32_t *const match_pos = mlen + chunk_size + 1;
+	uint32_t *const match_len = match_pos + chunk_size;
+	uint32_t *const nodes = match_len + chunk_size;
 
 	// Initialize lookup
-	for (unsigned long i = 0; i < LOOKUP_SIZE; ++i) {
+	for (unsigned long i = 0; i < (1UL << bits); ++i) {
 		lookup[i] = NO_MATCH_POS;
 	}
 
-	// Initialize to all literals with infinite cost
-	for (unsigned long i = 0; i <= src_size; ++i) {
-		cost[i] = UINT32_MAX;
-		mlen[i] = 1;
-		mpos[i] = 0;
-	}
-
-	cost[0] = 0;
-
 	// Next position where we are going to check matches
 	//
 	// This is used to skip matching while still updating the trees when
-	// we find a match that is accept_len or longer.
+	// we find a match that is accept_len or longer. Dictionary positions
+	// are only inserted into the trees.
 	//
-	unsigned long next_match_cur = 0;
+	unsigned long next_match_cur = dict_size;
+
+	// Insert dictionary positions
+	for (unsigned long cur = 0; cur < dict_size; ++cur) {
+		unsigned long pos;
+
+		lz4_btparse_insert(in, src_size, cur, nodes, lookup, bits, params,
+		                   &next_match_cur, &pos, &counts);
+	}
+
+	counts.time_build = lz4_stats_time(stats) - time_start;
+
+	unsigned char *out = (unsigned char *) dst;
+
+	// Start of literals not yet output
+	unsigned long next_lit = dict_size;
+
+	// Start of current chunk
+	unsigned long base = dict_size;
+
+	// Next position to insert into the trees
+	unsigned long tree_cur = dict_size;
+
+	// Last match of accept_len or longer before the current chunk, which
+	// made us skip checking matches up to its end
+	unsigned long skip_cur = 0;
+	unsigned long skip_pos = 0;
+	unsigned long skip_len = 0;
+
+	// Start of the input output since the last check, and the output
+	// size there, see lz4_region_shrinks
+	unsigned long region_cur = dict_size;
+	unsigned long region_size = 0;
+
+	for (;;) {
+		const unsigned long end = src_size - base > chunk_size ? base + chunk_size : src_size;
+		const unsigned long num_pos = end - base;
 
-	// Phase 1: Find lowest cost path arriving at each position
-	for (unsigned long cur = 0; cur <= last_match_pos; ++cur) {
-		// Check literal
+		// Initialize to all literals with infinite cost
 		//
-		// For literals, we store the number of literals up to the
-		// current position in mpos. This is used to update the cost
-		// from the current position with the additional cost of
-		// encoding the length of this run of literals in the next
-		// match.
+		// The arrays are indexed relative to base.
 		//
-		if (mlen[cur] == 1) {
-			unsigned long literals_cost = 1 + lz4_literal_cost(mpos[cur] + 1) - lz4_literal_cost(mpos[cur]);
-
-			if (cost[cur + 1] > cost[cur] + literals_cost) {
-				cost[cur + 1] = cost[cur] + literals_cost;
-				mlen[cur + 1] = 1;
-				mpos[cur + 1] = mpos[cur] + 1;
-			}
-		}
-		else {
-			if (cost[cur + 1] > cost[cur] + 1) {
-				cost[cur + 1] = cost[cur] + 1;
-				mlen[cur + 1] = 1;
-				mpos[cur + 1] = 1;
-			}
+		for (unsigned long i = 0; i <= num_pos; ++i) {
+			cost[i] = UINT32_MAX;
+			mlen[i] = 1;
+			mpos[i] = 0;
 		}
 
-		if (cur > next_match_cur) {
-			next_match_cur = cur;
-		}
+		cost[0] = 0;
+		mpos[0] = base - next_lit;
 
-		unsigned long max_len = 3;
-		unsigned long max_len_pos = NO_MATCH_POS;
+		time_start = lz4_stats_time(stats);
 
-		// Look up first match for current position
+		// Phase 1: Find longest match at each position
 		//
-		// pos is the current root of the tree of strings with this
-		// hash. We are going to re-root the tree so cur becomes the
-		// new root.
+		// Positions carried over from the previous chunk are already
+		// in the trees. Positions before base are inside a match that
+		// was output past the end of the previous chunk, and are only
+		// inserted.
 		//
-		const unsigned long hash = lz4_hash4_bits(&in[cur], LZ4_HASH_BITS);
-		unsigned long pos = lookup[hash];
-		lookup[hash] = cur;
-
-		uint32_t *lt_node = &nodes[2 * cur];
-		uint32_t *gt_node = &nodes[2 * cur + 1];
-		unsigned long lt_len = 0;
-		unsigned long gt_len = 0;
-
-		assert(pos == NO_MATCH_POS || pos < cur);
-
-		// If we are checking matches, allow lengths up to end of
-		// input, otherwise compare only up to accept_len
-		const unsigned long len_limit = cur == next_match_cur ? src_size - cur - 5
-		                              : accept_len < src_size - cur - 5 ? accept_len
-		                              : src_size - cur - 5;
-		unsigned long num_chain = max_depth;
-
-		// Check matches
-		for (;;) {
-			// If at bottom of tree, mark leaf nodes
-			//
-			// In case we reached max_depth, this also prunes the
-			// subtree we have not searched yet and do not know
-			// where belongs.
-			//
-			if (pos == NO_MATCH_POS || cur - pos > 65535 || num_chain-- == 0) {
-				*lt_node = NO_MATCH_POS;
-				*gt_node = NO_MATCH_POS;
+		for (unsigned long cur = tree_cur; cur < end && cur <= last_match_pos; ++cur) {
+			unsigned long pos = NO_MATCH_POS;
 
-				break;
-			}
+			const unsigned long len = lz4_btparse_insert(in, src_size, cur, nodes, lookup, bits, params,
+			                                             &next_match_cur, &pos, &counts);
 
-			// The string at pos is lexicographically greater than
-			// a string that matched in the first lt_len positions,
-			// and less than a string that matched in the first
-			// gt_len positions, so it must match up to at least
-			// the minimum of these.
-			unsigned long len = lt_len < gt_len ? lt_len : gt_len;
+			// Check if the trees are doing too much work
+			if (max_work != ULONG_MAX
+			 && counts.nodes_visited + counts.bytes_compared / 64
+			    > (unsigned long long) max_work * (cur + LZ4_BTPARSE_WINDOW_SIZE)) {
+				return LZ4_ERROR;
+			}
 
-			// Find match len
-			while (len < len_limit && in[pos + len] == in[cur + len]) {
-				++len;
+			if (cur >= base) {
+				match_len[cur - base] = len;
+				match_pos[cur - base] = pos;
 			}
 
-			// Update longest match found
-			if (cur == next_match_cur && len > max_len) {
-				max_len = len;
-				max_len_pos = pos;
+			tree_cur = cur + 1;
+		}
 
-				if (len >= accept_len) {
-					next_match_cur = cur + len;
-				}
-			}
+		// If the chunk starts inside a long match, the trees were not
+		// searched there, so continue that match
+		if (base <= last_match_pos && match_len[0] == 0 && base - skip_cur < skip_len) {
+			match_len[0] = skip_len - (base - skip_cur);
+			match_pos[0] = skip_pos + (base - skip_cur);
+		}
 
-			// If we reach maximum match length, the string at pos
-			// is equal to cur, so we can assign the left and right
-			// subtrees.
+		const double time_search = lz4_stats_time(stats);
+
+		counts.time_search += time_search - time_start;
+
+		// Phase 2: Find lowest cost path arriving at each position
+		for (unsigned long cur = base; cur < end; ++cur) {
+			const unsigned long i = cur - base;
+
+			// Check literal
 			//
-			// This removes pos from the tree, but we added cur
-			// which is equal and closer for future matches.
+			// For literals, we store the number of literals up to
+			// the current position in mpos. This is used to update
+			// the cost from the current position with the
+			// additional cost of encoding the length of this run
+			// of literals in the next match.
 			//
-			if (len >= accept_len || len == len_limit) {
-				*lt_node = nodes[2 * pos];
-				*gt_node = nodes[2 * pos + 1];
+			if (mlen[i] == 1) {
+				unsigned long literals_cost = 1 + lz4_literal_cost(mpos[i] + 1) - lz4_literal_cost(mpos[i]);
 
-				break;
+				if (cost[i + 1] > cost[i] + literals_cost) {
+					cost[i + 1] = cost[i] + literals_cost;
+					mlen[i + 1] = 1;
+					mpos[i + 1] = mpos[i] + 1;
+				}
+			}
+			else {
+				if (cost[i + 1] > cost[i] + 1) {
+					cost[i + 1] = cost[i] + 1;
+					mlen[i + 1] = 1;
+					mpos[i + 1] = 1;
+				}
+			}
+
+			if (cur > last_match_pos) {
+				continue;
 			}
 
-			// Go to previous match and restructure tree
+			// Limit match to end of chunk
+			const unsigned long max_len = match_len[i] < end - cur ? match_len[i] : end - cur;
+
+			// Update costs for longest match found
 			//
-			// lt_node points to a node that is going to contain
-			// elements lexicographically less than cur (the search
-			// string).
+			// If the match is longer than 18, decreasing the match
+			// length by up to 255 will result in saving 1 byte on
+			// the match length encoding.
 			//
-			// If the string at pos is less than cur, we set that
-			// lt_node to pos. We know that all elements in the
-			// left subtree are less than pos, and thus less than
-			// cur, so we point lt_node at the right subtree of
-			// pos and continue our search there.
+			// On the other hand, the best case is that the following
+			// sequence is a match that can be extended to the left
+			// to cover the bytes we no longer match, which increases
+			// the match length of that match. We can do this at most
+			// 254 times before its match length encoding goes up 1
+			// byte.
 			//
-			// The equivalent applies to gt_node when the string at
-			// pos is greater than cur.
+			// So we only have to check the last 255 posssible match
+			// lengths.
 			//
-			if (in[pos + len] < in[cur + len]) {
-				*lt_node = pos;
-				lt_node = &nodes[2 * pos + 1];
-				assert(*lt_node == NO_MATCH_POS || *lt_node < pos);
-				pos = *lt_node;
-				lt_len = len;
-			}
-			else {
-				*gt_node = pos;
-				gt_node = &nodes[2 * pos];
-				assert(*gt_node == NO_MATCH_POS || *gt_node < pos);
-				pos = *gt_node;
-				gt_len = len;
+			// This optimization is from lz4x by Ilya Muravyov.
+			//
+			if (max_len >= 4) {
+				unsigned long min_len = max_len > (254 + 4) ? max_len - 254 : 4;
+
+				for (unsigned long len = min_len; len <= max_len; ++len) {
+					unsigned long match_cost = lz4_match_cost(len);
+
+					assert(match_cost < UINT32_MAX - cost[i]);
+
+					unsigned long cost_there = cost[i] + match_cost;
+
+					// If the choice is between a literal and
+					// a match with the same cost, choose the
+					// match. This is because the match is able
+					// to encode any literals preceding it.
+					if (cost_there < cost[i + len]
+					 || (mlen[i + len] == 1 && cost_there == cost[i + len])) {
+						cost[i + len] = cost_there;
+						mpos[i + len] = match_pos[i];
+						mlen[i + len] = len;
+					}
+				}
 			}
 		}
 
-		// Update costs for longest match found
-		//
-		// If the match is longer than 18, decreasing the match length
-		// by up to 255 will result in saving 1 byte on the match
-		// length encoding.
-		//
-		// On the other hand, the best case is that the following
-		// sequence is a match that can be extended to the left to
-		// cover the bytes we no longer match, which increases the
-		// match length of that match. We can do this at most 254
-		// times before its match length encoding goes up 1 byte.
+		const double time_parse = lz4_stats_time(stats);
+
+		counts.time_parse += time_parse - time_search;
+
+		// Phase 3: Follow lowest cost path backwards gathering tokens
+		unsigned long next_token = num_pos;
+
+		for (unsigned long i = num_pos; i > 0; i -= mlen[i], --next_token) {
+			mlen[next_token] = mlen[i];
+			mpos[next_token] = mpos[i];
+		}
+
+		// Phase 4: Output tokens
 		//
-		// So we only have to check the last 255 posssible match
-		// lengths.
+		// Unless this is the last chunk, we stop at the first token
+		// that reaches into the overlap, but always take at least
+		// one, so we make progress.
 		//
-		// This optimization is from lz4x by Ilya Muravyov.
+		// If that one is a match that was limited to the end of the
+		// chunk, we output it with its full length instead, so a match
+		// longer than a chunk, like in a long run, is not split into
+		// several matches at chunk boundaries.
 		//
-		if (max_len_pos != NO_MATCH_POS) {
-			unsigned long min_len = max_len > (254 + 4) ? max_len - 254 : 4;
-
-			for (unsigned long i = min_len; i <= max_len; ++i) {
-				unsigned long match_cost = lz4_match_cost(i);
+		const unsigned long stop = end == src_size ? end : end - LZ4_BTPARSE_CHUNK_OVERLAP;
 
-				assert(match_cost < UINT32_MAX - cost[cur]);
+		unsigned long cur = base;
 
-				unsigned long cost_there = cost[cur] + match_cost;
+		for (unsigned long i = next_token + 1; i <= num_pos; cur += mlen[i++]) {
+			if (cur > base && cur + mlen[i] > stop) {
+				break;
+			}
 
-				// If the choice is between a literal and a
-				// match with the same cost, choose the match.
-				// This is because the match is able to encode
-				// any literals preceding it.
-				if (cost_there < cost[cur + i]
-				 || (mlen[cur + i] == 1 && cost_there == cost[cur + i])) {
-					cost[cur + i] = cost_there;
-					mpos[cur + i] = max_len_pos;
-					mlen[cur + i] = i;
+			if (mlen[i] != 1) {
+				if (cur == base && end != src_size && mlen[i] == num_pos && match_len[0] > num_pos) {
+					out = lz4_write_sequence(out, &in[next_lit], cur - next_lit, cur - mpos[i], match_len[0]);
+					cur += match_len[0];
+					next_lit = cur;
+					break;
 				}
+
+				out = lz4_write_sequence(out, &in[next_lit], cur - next_lit, cur - mpos[i], mlen[i]);
+				next_lit = cur + mlen[i];
 			}
 		}
-	}
 
-	for (unsigned long cur = last_match_pos + 1; cur < src_size; ++cur) {
-		// Check literal
-		if (mlen[cur] == 1) {
-			unsigned long literals_cost = 1 + lz4_literal_cost(mpos[cur] + 1) - lz4_literal_cost(mpos[cur]);
+		counts.time_emit += lz4_stats_time(stats) - time_parse;
 
-			if (cost[cur + 1] > cost[cur] + literals_cost) {
-				cost[cur + 1] = cost[cur] + literals_cost;
-				mlen[cur + 1] = 1;
-				mpos[cur + 1] = mpos[cur] + 1;
-			}
+		if (cur == src_size) {
+			break;
 		}
-		else {
-			if (cost[cur + 1] > cost[cur] + 1) {
-				cost[cur + 1] = cost[cur] + 1;
-				mlen[cur + 1] = 1;
-				mpos[cur + 1] = 1;
+
+		// Find last long match before the next chunk
+		for (unsigned long pos = base; pos < cur && pos < tree_cur; ++pos) {
+			if (match_len[pos - base] >= accept_len) {
+				skip_cur = pos;
+				skip_pos = match_pos[pos - base];
+				skip_len = match_len[pos - base];
 			}
 		}
-	}
 
-	// Phase 2: Follow lowest cost path backwards gathering tokens
-	unsigned long next_token = src_size;
+		// Move saved matches for the positions we parse again
+		for (unsigned long pos = cur; pos < tree_cur; ++pos) {
+			match_len[pos - cur] = match_len[pos - base];
+			match_pos[pos - cur] = match_pos[pos - base];
+		}
 
-	for (unsigned long cur = src_size; cur > 0; cur -= mlen[cur], --next_token) {
-		mlen[next_token] = mlen[cur];
-		mpos[next_token] = mpos[cur];
-	}
+		// If the output for this chunk did not shrink, compress the
+		// input with the fast parser a region at a time, until we get
+		// to a region that shrinks, which we go back and search
+		//
+		// The positions it covers are not inserted into the trees,
+		// which is safe since the search stops at the first position
+		// too far back to match. The lookup of the fast parser is in
+		// cost, which is free until the next chunk.
+		//
+		if (!lz4_region_shrinks(region_size, lz4_output_size((unsigned char *) dst, out, next_lit, cur),
+		                        cur - region_cur)) {
+			const unsigned long stretch_cur = cur;
 
-	// Phase 3: Output tokens
-	unsigned char *out = (unsigned char *) dst;
+			while (cur <= last_match_pos) {
+				unsigned char *const region_out = out;
+				const unsigned long region_next_lit = next_lit;
 
-	unsigned long cur = 0;
+				region_cur = cur;
+				region_size = lz4_output_size((unsigned char *) dst, out, next_lit, cur);
 
-	for (unsigned long i = next_token + 1; i <= src_size; cur += mlen[i++]) {
-		unsigned long next_lit = cur;
-		unsigned long nlit = 0;
+				for (unsigned long i = 0; i < (1UL << LZ4_FASTPARSE_STRETCH_BITS); ++i) {
+					cost[i] = NO_MATCH_POS;
+				}
 
-		// Move over literals, counting them
-		while (i <= src_size && mlen[i] == 1) {
-			++nlit;
-			++i;
-			++cur;
-		}
+				out = lz4_fastparse_stretch(in, out, src_size, &cur, cur + LZ4_REGION_SIZE, &next_lit,
+				                            cost, LZ4_FASTPARSE_STRETCH_BITS, 1, params->window_size);
 
-		// Make room for token
-		unsigned char *token_out = out++;
+				if (cur <= last_match_pos
+				 && lz4_region_shrinks(region_size, lz4_output_size((unsigned char *) dst, out, next_lit, cur),
+				                       cur - region_cur)) {
+					out = region_out;
+					next_lit = region_next_lit;
+					cur = region_cur;
+					break;
+				}
+			}
 
-		// Output extra literal length bytes
-		while (nlit >= 15 + 255) {
-			*out++ = 255;
-			nlit -= 255;
-		}
-		if (nlit >= 15) {
-			*out++ = nlit - 15;
-			nlit = 15;
-		}
+			if (cur > last_match_pos) {
+				break;
+			}
 
-		// Output literals
-		while (next_lit < cur) {
-			*out++ = in[next_lit++];
-		}
+			// Move saved matches for any positions still ahead
+			for (unsigned long pos = cur; pos < tree_cur; ++pos) {
+				match_len[pos - cur] = match_len[pos - stretch_cur];
+				match_pos[pos - cur] = match_pos[pos - stretch_cur];
+			}
 
-		// Handle last incomplete sequence
-		if (i > src_size) {
-			// Write token
-			*token_out = nlit << 4;
-			break;
+			if (tree_cur < cur) {
+				tree_cur = cur;
+			}
 		}
 
-		// Output offset
-		unsigned long offs = mlen[i] == 1 ? 1 : cur - mpos[i];
-
-		*out++ = offs & 0xFF;
-		*out++ = (offs >> 8) & 0xFF;
+		region_cur = cur;
+		region_size = lz4_output_size((unsigned char *) dst, out, next_lit, cur);
 
-		// Output extra length bytes
-		unsigned long len = mlen[i];
-
-		while (len >= 19 + 255) {
-			*out++ = 255;
-			len -= 255;
-		}
-		if (len >= 19) {
-			*out++ = len - 19;
-			len = 19;
-		}
+		base = cur;
+	}
 
-		// Write token
-		*token_out = (nlit << 4) | (len - 4);
+	// Output last literals
+	out = lz4_write_sequence(out, &in[next_lit], src_size - next_lit, 0, 0);
+
+	if (stats != NULL) {
+		stats->time_build += counts.time_build;
+		stats->time_search += counts.time_search;
+		stats->time_parse += counts.time_parse;
+		stats->time_emit += counts.time_emit;
+		stats->nodes_visited += counts.nodes_visited;
+		stats->bytes_compared += counts.bytes_compared;
+		stats->accept_cutoffs += counts.accept_cutoffs;
 	}
 
 	// Return compressed size
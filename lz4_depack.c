@@ -26,11 +26,86 @@
  */
 
 #include "lz4.h"
+#include "lz4_kernels.h"
 
 #include <assert.h>
+#include <string.h>
 
-unsigned long
-lz4_depack(const void *src, void *dst, unsigned long packed_size)
+/*
+ * Sequences are decoded with wild copies while at least this many bytes
+ * of input remain, so literals can be read in chunks of 16 bytes.
+ */
+#define LZ4_FAST_IN_MARGIN 32
+
+/*
+ * Copy from `src` to `dst` in chunks of 8 bytes until `dst_end` is
+ * reached, which may write up to 7 bytes past `dst_end`. If they overlap,
+ * `src` must be at least 8 bytes before `dst`.
+ */
+static void
+lz4_wild_copy8(unsigned char *dst, const unsigned char *src,
+               const unsigned char *dst_end)
+{
+	do {
+		memcpy(dst, src, 8);
+		dst += 8;
+		src += 8;
+	} while (dst < dst_end);
+}
+
+/*
+ * Copy from `src` to `dst` in chunks of 16 bytes until `dst_end` is
+ * reached, which may write up to 15 bytes past `dst_end`. If they
+ * overlap, `src` must be at least 16 bytes before `dst`.
+ */
+static void
+lz4_wild_copy16(unsigned char *dst, const unsigned char *src,
+                const unsigned char *dst_end)
+{
+	do {
+		memcpy(dst, src, 16);
+		dst += 16;
+		src += 16;
+	} while (dst < dst_end);
+}
+
+/*
+ * Copy match of `len` bytes at offset `offs` < 16 from `out`.
+ *
+ * The first 8 bytes are copied so the distance between source and
+ * destination becomes a multiple of `offs` of at least 8, after which
+ * the repeating pattern can be copied in chunks of 8 bytes. This is the
+ * approach used by LZ4 by Yann Collet.
+ */
+static void
+lz4_wild_match_copy(unsigned char *out, unsigned long offs, unsigned long len)
+{
+	static const unsigned char inc[8] = { 0, 1, 2, 1, 0, 4, 4, 4 };
+	static const signed char dec[8] = { 0, 0, 0, -1, -4, 1, 2, 3 };
+	const unsigned char *match = out - offs;
+
+	if (offs < 8) {
+		out[0] = match[0];
+		out[1] = match[1];
+		out[2] = match[2];
+		out[3] = match[3];
+		match += inc[offs];
+		memcpy(out + 4, match, 4);
+		match -= dec[offs];
+	}
+	else {
+		memcpy(out, match, 8);
+		match += 8;
+	}
+
+	if (len > 8) {
+		lz4_wild_copy8(out + 8, match, out + len);
+	}
+}
+
+static unsigned long
+lz4_depack_internal(const void *src, void *dst, unsigned long packed_size,
+                    const unsigned char *dict, unsigned long dict_size)
 {
 	const unsigned char *in = (unsigned char *) src;
 	unsigned char *out = (unsigned char *) dst;
@@ -38,7 +113,10 @@ lz4_depack(const void *src, void *dst, unsigned long packed_size)
 	unsigned long cur = 0;
 	unsigned long prev_match_start = 0;
 
-	if (in[0] == 0) {
+	lz4_kernels_init();
+
+	/* Without a dictionary, only empty input starts with a match */
+	if (dict_size == 0 && in[0] == 0) {
 		return 0;
 	}
 
@@ -48,7 +126,6 @@ lz4_depack(const void *src, void *dst, unsigned long packed_size)
 		unsigned long lit_len = token >> 4;
 		unsigned long len = (token & 0x0F) + 4;
 		unsigned long offs;
-		unsigned long i;
 
 		/* Read extra literal length bytes */
 		if (lit_len == 15) {
@@ -60,9 +137,9 @@ lz4_depack(const void *src, void *dst, unsigned long packed_size)
 		}
 
 		/* Copy literals */
-		for (i = 0; i < lit_len; ++i) {
-			out[dst_size++] = in[cur++];
-		}
+		lz4_kernels->copy(&out[dst_size], &in[cur], lit_len);
+		dst_size += lit_len;
+		cur += lit_len;
 
 		/* Check for last incomplete sequence */
 		if (cur == packed_size) {
@@ -93,13 +170,531 @@ lz4_depack(const void *src, void *dst, unsigned long packed_size)
 
 		prev_match_start = dst_size;
 
-		/* Copy match */
-		for (i = 0; i < len; ++i) {
-			out[dst_size] = out[dst_size - offs];
-			++dst_size;
+		/* Copy part of match that is in dictionary */
+		if (offs > dst_size) {
+			unsigned long dict_offs = offs - dst_size;
+			unsigned long dict_len = dict_offs < len ? dict_offs : len;
+
+			if (dict_offs > dict_size) {
+				return LZ4_ERROR;
+			}
+
+			lz4_kernels->copy(&out[dst_size], &dict[dict_size - dict_offs], dict_len);
+			dst_size += dict_len;
+			len -= dict_len;
 		}
+
+		/* Copy match */
+		lz4_kernels->match_copy(&out[dst_size], offs, len);
+		dst_size += len;
 	}
 
 	/* Return decompressed size */
 	return dst_size;
 }
+
+unsigned long
+lz4_depack(const void *src, void *dst, unsigned long packed_size)
+{
+	return lz4_depack_internal(src, dst, packed_size, NULL, 0);
+}
+
+unsigned long
+lz4_depack_fast(const void *src, void *dst, unsigned long packed_size)
+{
+	const unsigned char *in = (const unsigned char *) src;
+	const unsigned char *const in_end = in + packed_size;
+	const unsigned char *const in_fast_end = packed_size > LZ4_FAST_IN_MARGIN
+	                                       ? in_end - LZ4_FAST_IN_MARGIN : in;
+	unsigned char *const out_start = (unsigned char *) dst;
+	unsigned char *out = out_start;
+	unsigned char *prev_match_start = out_start;
+
+	lz4_kernels_init();
+
+	/* Check for empty input */
+	if (in[0] == 0) {
+		return 0;
+	}
+
+	/*
+	 * Fast loop, using wild copies.
+	 *
+	 * Literals are followed by at least a 4 byte match and the 5 last
+	 * literals, and matches by the 5 last literals, so the wild copies
+	 * write at most 11 bytes past the end of the decompressed data.
+	 */
+	while (in < in_fast_end) {
+		const unsigned char *const seq_start = in;
+		unsigned long token = *in++;
+		unsigned long lit_len = token >> 4;
+		unsigned long len = (token & 0x0F) + 4;
+		unsigned long offs;
+
+		/* Read extra literal length bytes */
+		if (lit_len == 15) {
+			while (*in == 255) {
+				lit_len += 255;
+				++in;
+			}
+			lit_len += *in++;
+		}
+
+		/* Decode sequences with literals close to the end in tail */
+		if ((unsigned long) (in_end - in) < lit_len + LZ4_FAST_IN_MARGIN) {
+			in = seq_start;
+			break;
+		}
+
+		/* Copy literals */
+		lz4_wild_copy16(out, in, out + lit_len);
+		out += lit_len;
+		in += lit_len;
+
+		/* Read offset */
+		offs = (unsigned long) in[0] | ((unsigned long) in[1] << 8);
+		in += 2;
+
+		/* Read extra length bytes */
+		if (len == 19) {
+			while (*in == 255) {
+				len += 255;
+				++in;
+			}
+			len += *in++;
+		}
+
+		prev_match_start = out;
+
+		/* Copy match */
+		if (offs >= 16) {
+			lz4_wild_copy16(out, out - offs, out + len);
+		}
+		else {
+			lz4_wild_match_copy(out, offs, len);
+		}
+
+		out += len;
+	}
+
+	/* Tail loop, copying exactly */
+	while (in < in_end) {
+		unsigned long token = *in++;
+		unsigned long lit_len = token >> 4;
+		unsigned long len = (token & 0x0F) + 4;
+		unsigned long offs;
+
+		/* Read extra literal length bytes */
+		if (lit_len == 15) {
+			while (*in == 255) {
+				lit_len += 255;
+				++in;
+			}
+			lit_len += *in++;
+		}
+
+		/* Copy literals */
+		lz4_kernels->copy(out, in, lit_len);
+		out += lit_len;
+		in += lit_len;
+
+		/* Check for last incomplete sequence */
+		if (in == in_end) {
+			/* Check parsing restrictions */
+			if (out - out_start >= 5 && lit_len < 5) {
+				return LZ4_ERROR;
+			}
+
+			if (out - out_start > 12 && out - prev_match_start < 12) {
+				return LZ4_ERROR;
+			}
+
+			break;
+		}
+
+		/* Read offset */
+		offs = (unsigned long) in[0] | ((unsigned long) in[1] << 8);
+		in += 2;
+
+		/* Read extra length bytes */
+		if (len == 19) {
+			while (*in == 255) {
+				len += 255;
+				++in;
+			}
+			len += *in++;
+		}
+
+		prev_match_start = out;
+
+		/* Copy match */
+		lz4_kernels->match_copy(out, offs, len);
+		out += len;
+	}
+
+	/* Return decompressed size */
+	return (unsigned long) (out - out_start);
+}
+
+/*
+ * Read extra length bytes at `in`, adding them to `*len`.
+ *
+ * Returns pointer to the byte following the length, or NULL if the
+ * length runs past `in_end`.
+ */
+static const unsigned char *
+lz4_read_length_safe(const unsigned char *in, const unsigned char *in_end,
+                     unsigned long *len)
+{
+	unsigned long val;
+
+	do {
+		if (in >= in_end) {
+			return NULL;
+		}
+
+		val = *in++;
+		*len += val;
+	} while (val == 255);
+
+	return in;
+}
+
+/*
+ * Safe decompression.
+ *
+ * If `partial` is set, decompression stops once `dst_capacity` bytes have
+ * been produced, instead of this being an error.
+ */
+static unsigned long
+lz4_depack_safe_internal(const void *src, void *dst, unsigned long packed_size,
+                         unsigned long dst_capacity,
+                         const unsigned char *dict, unsigned long dict_size,
+                         int partial)
+{
+	const unsigned char *in = (const unsigned char *) src;
+	const unsigned char *const in_end = in + packed_size;
+	const unsigned char *const in_fast_end = packed_size > LZ4_FAST_IN_MARGIN
+	                                       ? in_end - LZ4_FAST_IN_MARGIN : in;
+	unsigned char *const out_start = (unsigned char *) dst;
+	unsigned char *const out_end = out_start + dst_capacity;
+	unsigned char *out = out_start;
+	unsigned char *prev_match_start = out_start;
+
+	lz4_kernels_init();
+
+	if (packed_size == 0) {
+		return LZ4_ERROR;
+	}
+
+	/* Without a dictionary, only empty input starts with a match */
+	if (dict_size == 0 && in[0] == 0) {
+		return packed_size == 1 ? 0 : LZ4_ERROR;
+	}
+
+	/*
+	 * Fast loop, using wild copies.
+	 *
+	 * Sequences are only decoded here if their literals leave room for
+	 * wild copies in both input and output, so the checks in the loop
+	 * are mostly on lengths and offsets.
+	 */
+	while (in < in_fast_end) {
+		const unsigned char *const seq_start = in;
+		unsigned long token = *in++;
+		unsigned long lit_len = token >> 4;
+		unsigned long len = (token & 0x0F) + 4;
+		unsigned long offs;
+
+		/* Read extra literal length bytes */
+		if (lit_len == 15 && (in = lz4_read_length_safe(in, in_end, &lit_len)) == NULL) {
+			return LZ4_ERROR;
+		}
+
+		/* Decode sequences with literals close to the end in tail */
+		if ((unsigned long) (in_end - in) < lit_len + LZ4_FAST_IN_MARGIN
+		 || (unsigned long) (out_end - out) < lit_len + LZ4_FAST_IN_MARGIN) {
+			in = seq_start;
+			break;
+		}
+
+		/* Copy literals */
+		lz4_wild_copy16(out, in, out + lit_len);
+		out += lit_len;
+		in += lit_len;
+
+		/* Read offset, which the margin leaves room for */
+		offs = (unsigned long) in[0] | ((unsigned long) in[1] << 8);
+		in += 2;
+
+		/* Read extra length bytes */
+		if (len == 19 && (in = lz4_read_length_safe(in, in_end, &len)) == NULL) {
+			return LZ4_ERROR;
+		}
+
+		prev_match_start = out;
+
+		/*
+		 * Copy match using wild copy if the offset is within the output
+		 * so far and there is room, where offset zero wraps around
+		 */
+		if (offs - 1 < (unsigned long) (out - out_start)
+		 && len + LZ4_FAST_IN_MARGIN <= (unsigned long) (out_end - out)) {
+			if (offs >= 16) {
+				lz4_wild_copy16(out, out - offs, out + len);
+			}
+			else {
+				lz4_wild_match_copy(out, offs, len);
+			}
+
+			out += len;
+
+			continue;
+		}
+
+		if (offs == 0) {
+			return LZ4_ERROR;
+		}
+
+		/* Check match fits, or copy part of it for partial */
+		if (len > (unsigned long) (out_end - out)) {
+			if (!partial) {
+				return LZ4_ERROR;
+			}
+
+			len = (unsigned long) (out_end - out);
+		}
+
+		/* Copy part of match that is in dictionary */
+		if (offs > (unsigned long) (out - out_start)) {
+			unsigned long dict_offs = offs - (unsigned long) (out - out_start);
+			unsigned long dict_len = dict_offs < len ? dict_offs : len;
+
+			if (dict_offs > dict_size) {
+				return LZ4_ERROR;
+			}
+
+			lz4_kernels->copy(out, &dict[dict_size - dict_offs], dict_len);
+			out += dict_len;
+			len -= dict_len;
+		}
+
+		/* Copy match exactly */
+		lz4_kernels->match_copy(out, offs, len);
+		out += len;
+	}
+
+	/* Tail loop, checking every length */
+	for (;;) {
+		unsigned long token;
+		unsigned long lit_len;
+		unsigned long len;
+		unsigned long offs;
+
+		/* Stop if partial decompression has produced enough */
+		if (partial && out == out_end) {
+			break;
+		}
+
+		/* Data must end with literals */
+		if (in >= in_end) {
+			return LZ4_ERROR;
+		}
+
+		token = *in++;
+		lit_len = token >> 4;
+		len = (token & 0x0F) + 4;
+
+		/* Read extra literal length bytes */
+		if (lit_len == 15 && (in = lz4_read_length_safe(in, in_end, &lit_len)) == NULL) {
+			return LZ4_ERROR;
+		}
+
+		if (lit_len > (unsigned long) (in_end - in)) {
+			return LZ4_ERROR;
+		}
+
+		/* Check literals fit, or copy part of them for partial */
+		if (lit_len > (unsigned long) (out_end - out)) {
+			if (!partial) {
+				return LZ4_ERROR;
+			}
+
+			lz4_kernels->copy(out, in, (unsigned long) (out_end - out));
+			out = out_end;
+
+			break;
+		}
+
+		/* Copy literals */
+		lz4_kernels->copy(out, in, lit_len);
+		out += lit_len;
+		in += lit_len;
+
+		/* Check for last incomplete sequence */
+		if (in == in_end) {
+			/* Check parsing restrictions */
+			if (out - out_start >= 5 && lit_len < 5) {
+				return LZ4_ERROR;
+			}
+
+			if (out - out_start > 12 && out - prev_match_start < 12) {
+				return LZ4_ERROR;
+			}
+
+			break;
+		}
+
+		/* Read offset */
+		if (in_end - in < 2) {
+			return LZ4_ERROR;
+		}
+
+		offs = (unsigned long) in[0] | ((unsigned long) in[1] << 8);
+		in += 2;
+
+		/* Read extra length bytes */
+		if (len == 19 && (in = lz4_read_length_safe(in, in_end, &len)) == NULL) {
+			return LZ4_ERROR;
+		}
+
+		if (offs == 0) {
+			return LZ4_ERROR;
+		}
+
+		/* Check match fits, or copy part of it for partial */
+		if (len > (unsigned long) (out_end - out)) {
+			if (!partial) {
+				return LZ4_ERROR;
+			}
+
+			len = (unsigned long) (out_end - out);
+		}
+
+		prev_match_start = out;
+
+		/* Copy part of match that is in dictionary */
+		if (offs > (unsigned long) (out - out_start)) {
+			unsigned long dict_offs = offs - (unsigned long) (out - out_start);
+			unsigned long dict_len = dict_offs < len ? dict_offs : len;
+
+			if (dict_offs > dict_size) {
+				return LZ4_ERROR;
+			}
+
+			lz4_kernels->copy(out, &dict[dict_size - dict_offs], dict_len);
+			out += dict_len;
+			len -= dict_len;
+		}
+
+		/* Copy match */
+		lz4_kernels->match_copy(out, offs, len);
+		out += len;
+	}
+
+	/* Return decompressed size */
+	return (unsigned long) (out - out_start);
+}
+
+unsigned long
+lz4_depack_safe(const void *src, void *dst, unsigned long packed_size,
+                unsigned long dst_capacity)
+{
+	return lz4_depack_safe_internal(src, dst, packed_size, dst_capacity,
+	                                NULL, 0, 0);
+}
+
+unsigned long
+lz4_depack_safe_dict(const void *src, void *dst, unsigned long packed_size,
+                     unsigned long dst_capacity,
+                     const void *dict, unsigned long dict_size)
+{
+	/* Only the last LZ4_DICT_SIZE_MAX bytes can be reached by offsets */
+	if (dict_size > LZ4_DICT_SIZE_MAX) {
+		dict = (const unsigned char *) dict + (dict_size - LZ4_DICT_SIZE_MAX);
+		dict_size = LZ4_DICT_SIZE_MAX;
+	}
+
+	return lz4_depack_safe_internal(src, dst, packed_size, dst_capacity,
+	                                (const unsigned char *) dict, dict_size, 0);
+}
+
+unsigned long
+lz4_depack_partial(const void *src, void *dst, unsigned long packed_size,
+                   unsigned long target_size)
+{
+	return lz4_depack_safe_internal(src, dst, packed_size, target_size,
+	                                NULL, 0, 1);
+}
+
+unsigned long
+lz4_depack_dict(const void *src, void *dst, unsigned long packed_size,
+                const void *dict, unsigned long dict_size)
+{
+	/* Only the last LZ4_DICT_SIZE_MAX bytes can be reached by offsets */
+	if (dict_size > LZ4_DICT_SIZE_MAX) {
+		dict = (const unsigned char *) dict + (dict_size - LZ4_DICT_SIZE_MAX);
+		dict_size = LZ4_DICT_SIZE_MAX;
+	}
+
+	return lz4_depack_internal(src, dst, packed_size,
+	                           (const unsigned char *) dict, dict_size);
+}
+
+/*
+ * clang -g -O1 -fsanitize=fuzzer,address -DLZ4_FUZZING lz4_depack.c lz4_kernels.c
+ *
+ * The first three bytes of the fuzzer input are the capacity of the
+ * destination and the size of the dictionary, and the rest is the
+ * compressed data. All buffers are allocated with their exact size, so
+ * reads and writes outside them are caught.
+ */
+#if defined(LZ4_FUZZING)
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+extern int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	unsigned long capacity, dict_size, packed_size, res, i;
+	unsigned char *packed, *dict, *depacked, *partial;
+
+	if (size < 3 || size > 1024 * 1024UL) { return 0; }
+
+	capacity = ((unsigned long) data[0] | ((unsigned long) data[1] << 8)) << 2;
+	dict_size = (unsigned long) data[2] << 8;
+	packed_size = (unsigned long) (size - 3);
+
+	packed = (unsigned char *) malloc(packed_size);
+	dict = (unsigned char *) malloc(dict_size);
+	depacked = (unsigned char *) malloc(capacity);
+	partial = (unsigned char *) malloc(capacity);
+	if ((!packed && packed_size) || (!dict && dict_size)
+	 || (!depacked && capacity) || (!partial && capacity)) { abort(); }
+
+	memcpy(packed, data + 3, packed_size);
+	for (i = 0; i < dict_size; ++i) { dict[i] = (unsigned char) (i * 7); }
+
+	res = lz4_depack_safe(packed, depacked, packed_size, capacity);
+	if (res != LZ4_ERROR && res > capacity) { abort(); }
+
+	/* Partial decompression up to the size gives the same data */
+	if (res != LZ4_ERROR) {
+		if (lz4_depack_partial(packed, partial, packed_size, res) != res
+		 || memcmp(depacked, partial, res) != 0) { abort(); }
+	}
+
+	res = lz4_depack_partial(packed, partial, packed_size, capacity);
+	if (res != LZ4_ERROR && res > capacity) { abort(); }
+
+	res = lz4_depack_safe_dict(packed, depacked, packed_size, capacity, dict, dict_size);
+	if (res != LZ4_ERROR && res > capacity) { abort(); }
+
+	free(partial);
+	free(depacked);
+	free(dict);
+	free(packed);
+	return 0;
+}
+#endif
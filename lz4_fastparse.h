@@ -0,0 +1,199 @@
+//
+// blz4 - Example of LZ4 compression with BriefLZ algorithms
+//
+// Greedy parse using a single-probe hash table
+//
+// Copyright (c) 2026 Joergen Ibsen
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must
+//      not claim that you wrote the original software. If you use this
+//      software in a product, an acknowledgment in the product
+//      documentation would be appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must
+//      not be misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//      distribution.
+//
+
+#ifndef LZ4_FASTPARSE_H_INCLUDED
+#define LZ4_FASTPARSE_H_INCLUDED
+
+// Log2 of the number of misses before the step size used to move over
+// input without matches is increased by one.
+//
+// The step starts at the acceleration, and grows by one every
+// 1 << LZ4_FASTPARSE_SKIP_TRIGGER misses.
+//
+#define LZ4_FASTPARSE_SKIP_TRIGGER 6
+
+// Number of hash bits of the lookup other parsers give to
+// lz4_fastparse_stretch.
+//
+#define LZ4_FASTPARSE_STRETCH_BITS 12
+
+static size_t
+lz4_fastparse_workmem_size(size_t src_size, int max_bits)
+{
+	return (1UL << lz4_lookup_bits(src_size, max_bits)) * sizeof(uint32_t);
+}
+
+// Greedy parse of the input from *cur_ptr up to end, using the lookup
+// of 1 << bits entries.
+//
+// Sequences are written from out, and the end of the output is returned.
+// The literals from *next_lit_ptr are left pending, and *cur_ptr and
+// *next_lit_ptr are updated, so the caller can continue from there with
+// another parser. The last match may reach past end.
+//
+// The other parsers use this for stretches of input where searching does
+// not pay off, see lz4_region_shrinks.
+//
+static unsigned char *
+lz4_fastparse_stretch(const unsigned char *in, unsigned char *out, unsigned long src_size,
+                      unsigned long *cur_ptr, unsigned long end, unsigned long *next_lit_ptr,
+                      uint32_t *lookup, int bits, unsigned long acceleration,
+                      unsigned long window_size)
+{
+	const unsigned long last_match_pos = src_size > 12 ? src_size - 12 : 0;
+
+	// Start of literals not yet output
+	unsigned long next_lit = *next_lit_ptr;
+
+	unsigned long cur = *cur_ptr;
+
+	for (;;) {
+		unsigned long search_count = acceleration << LZ4_FASTPARSE_SKIP_TRIGGER;
+		unsigned long pos;
+
+		// Find next match
+		for (;;) {
+			if (cur >= end || cur > last_match_pos) {
+				*cur_ptr = cur;
+				*next_lit_ptr = next_lit;
+
+				return out;
+			}
+
+			const unsigned long hash = lz4_hash4_bits(&in[cur], bits);
+			pos = lookup[hash];
+			lookup[hash] = cur;
+
+			assert(pos == NO_MATCH_POS || pos < cur);
+
+			if (pos != NO_MATCH_POS && cur - pos <= window_size
+			 && in[pos] == in[cur] && in[pos + 1] == in[cur + 1]
+			 && in[pos + 2] == in[cur + 2] && in[pos + 3] == in[cur + 3]) {
+				break;
+			}
+
+			cur += search_count++ >> LZ4_FASTPARSE_SKIP_TRIGGER;
+		}
+
+		// Extend match backwards over pending literals
+		while (cur > next_lit && pos > 0 && in[pos - 1] == in[cur - 1]) {
+			--cur;
+			--pos;
+		}
+
+		// Find match len
+		const unsigned long len_limit = src_size - cur - 5;
+		unsigned long len = 4;
+
+		len = lz4_match_len(&in[pos], &in[cur], len, len_limit);
+
+		out = lz4_write_sequence(out, &in[next_lit], cur - next_lit, cur - pos, len);
+
+		cur += len;
+		next_lit = cur;
+
+		// Insert position close to end of match, which helps find
+		// matches in repetitive data
+		if (cur - 2 <= last_match_pos) {
+			lookup[lz4_hash4_bits(&in[cur - 2], bits)] = cur - 2;
+		}
+	}
+}
+
+// Greedy parse using a single-probe hash table.
+//
+// For each position we look up the most recent position with the same
+// hash, and if the four bytes there match, we extend the match in both
+// directions and take it.
+//
+// When we do not find matches, the step size used to move forward is
+// gradually increased, which allows us to quickly skip incompressible
+// parts of the input. The acceleration is the initial step size, given in
+// accept_len of params, larger values are faster but give worse ratio.
+// The hash_bits of params is the maximum number of hash bits.
+//
+// This is the same approach as the fast mode of LZ4 by Yann Collet.
+//
+static unsigned long
+lz4_pack_fastparse(const void *src, void *dst, unsigned long src_size,
+                   unsigned long dict_size, void *workmem,
+                   const struct lz4_params *params)
+{
+	const unsigned char *const in = (const unsigned char *) src;
+	const unsigned long acceleration = params->accept_len;
+
+	assert(acceleration > 0);
+
+	// Check for empty input
+	if (src_size == dict_size) {
+		unsigned char *out = (unsigned char *) dst;
+		*out++ = 0;
+		return 1;
+	}
+
+	// Check for input without room for match
+	if (src_size - dict_size < 13) {
+		unsigned char *out = (unsigned char *) dst;
+		*out++ = (src_size - dict_size) << 4;
+		for (unsigned long i = dict_size; i < src_size; ++i) {
+			*out++ = in[i];
+		}
+		return 1 + src_size - dict_size;
+	}
+
+	uint32_t *const lookup = (uint32_t *) workmem;
+
+	const int bits = lz4_lookup_bits(src_size, params->hash_bits);
+
+	// Initialize lookup
+	for (unsigned long i = 0; i < (1UL << bits); ++i) {
+		lookup[i] = NO_MATCH_POS;
+	}
+
+	// Insert dictionary positions
+	for (unsigned long i = 0; i < dict_size; ++i) {
+		lookup[lz4_hash4_bits(&in[i], bits)] = i;
+	}
+
+	unsigned char *out = (unsigned char *) dst;
+
+	// Start of literals not yet output
+	unsigned long next_lit = dict_size;
+
+	unsigned long cur = dict_size;
+
+	out = lz4_fastparse_stretch(in, out, src_size, &cur, src_size, &next_lit,
+	                            lookup, bits, acceleration, params->window_size);
+
+	// Output last literals
+	out = lz4_write_sequence(out, &in[next_lit], src_size - next_lit, 0, 0);
+
+	// Return compressed size
+	return (unsigned long) (out - (unsigned char *) dst);
+}
+
+#endif /* LZ4_FASTPARSE_H_INCLUDED */
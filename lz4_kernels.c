@@ -0,0 +1,433 @@
+//
+// blz4 - Example of LZ4 compression with BriefLZ algorithms
+//
+// Kernels selected at runtime based on CPU features
+//
+// Copyright (c) 2026 Joergen Ibsen
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must
+//      not claim that you wrote the original software. If you use this
+//      software in a product, an acknowledgment in the product
+//      documentation would be appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must
+//      not be misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//      distribution.
+//
+
+#include "lz4_kernels.h"
+
+#include "blz4_thread.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if _MSC_VER >= 1400
+#  include <intrin.h>
+#  define LZ4_BUILTIN_MSVC
+#elif defined(__clang__) && defined(__has_builtin)
+#  if __has_builtin(__builtin_ctz)
+#    define LZ4_BUILTIN_GCC
+#  endif
+#elif __GNUC__ > 3 || (__GNUC__ == 3 && __GNUC_MINOR__ >= 4)
+#  define LZ4_BUILTIN_GCC
+#endif
+
+// SSE2 and AVX2 kernels are compiled with target attributes on GCC and
+// Clang, so the rest of the library does not require these instruction
+// sets. MSVC allows using the intrinsics without special options.
+//
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#  include <immintrin.h>
+#  define LZ4_X86_KERNELS
+#  define LZ4_TARGET_SSE2
+#  define LZ4_TARGET_AVX2
+#elif (defined(__i386__) || defined(__x86_64__)) && defined(LZ4_BUILTIN_GCC) \
+   && (defined(__clang__) || __GNUC__ >= 5)
+#  include <immintrin.h>
+#  define LZ4_X86_KERNELS
+#  define LZ4_TARGET_SSE2 __attribute__((target("sse2")))
+#  define LZ4_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM64))
+#  define LZ4_LITTLE_ENDIAN
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define LZ4_LITTLE_ENDIAN
+#endif
+
+static const char *const lz4_kernel_names[] = {
+	"auto", "scalar", "sse2", "avx2"
+};
+
+// Get number of trailing zero bits in n, which must be non-zero.
+static int
+lz4_ctz64(uint64_t n)
+{
+#if defined(LZ4_BUILTIN_MSVC) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long lsb_pos;
+	_BitScanForward64(&lsb_pos, n);
+	return (int) lsb_pos;
+#elif defined(LZ4_BUILTIN_MSVC)
+	unsigned long lsb_pos;
+	if (_BitScanForward(&lsb_pos, (unsigned long) n)) {
+		return (int) lsb_pos;
+	}
+	_BitScanForward(&lsb_pos, (unsigned long) (n >> 32));
+	return 32 + (int) lsb_pos;
+#elif defined(LZ4_BUILTIN_GCC)
+	return __builtin_ctzll(n);
+#else
+	int bits = 0;
+
+	while ((n & 1) == 0) {
+		n >>= 1;
+		++bits;
+	}
+
+	return bits;
+#endif
+}
+
+//
+// Scalar kernels
+//
+
+// On little-endian machines this compares eight bytes at a time, using
+// the lowest set bit of the exclusive or of two words to find the first
+// mismatch.
+//
+static unsigned long
+lz4_match_len_scalar(const unsigned char *a, const unsigned char *b,
+                     unsigned long len, unsigned long len_limit)
+{
+#if defined(LZ4_LITTLE_ENDIAN)
+	while (len + 8 <= len_limit) {
+		uint64_t a_val;
+		uint64_t b_val;
+
+		memcpy(&a_val, a + len, sizeof(a_val));
+		memcpy(&b_val, b + len, sizeof(b_val));
+
+		if (a_val != b_val) {
+			return len + (unsigned long) (lz4_ctz64(a_val ^ b_val) >> 3);
+		}
+
+		len += 8;
+	}
+#endif
+
+	while (len < len_limit && a[len] == b[len]) {
+		++len;
+	}
+
+	return len;
+}
+
+static void
+lz4_copy_scalar(unsigned char *dst, const unsigned char *src, unsigned long len)
+{
+	memcpy(dst, src, len);
+}
+
+static void
+lz4_match_copy_scalar(unsigned char *dst, unsigned long offs, unsigned long len)
+{
+	const unsigned char *src = dst - offs;
+
+	// Copy eight bytes at a time if they do not overlap
+	if (offs >= 8) {
+		while (len >= 8) {
+			memcpy(dst, src, 8);
+			dst += 8;
+			src += 8;
+			len -= 8;
+		}
+	}
+
+	while (len-- > 0) {
+		*dst++ = *src++;
+	}
+}
+
+#if defined(LZ4_X86_KERNELS)
+
+//
+// SSE2 kernels
+//
+
+LZ4_TARGET_SSE2 static unsigned long
+lz4_match_len_sse2(const unsigned char *a, const unsigned char *b,
+                   unsigned long len, unsigned long len_limit)
+{
+	while (len + 16 <= len_limit) {
+		const __m128i a_val = _mm_loadu_si128((const __m128i *) (a + len));
+		const __m128i b_val = _mm_loadu_si128((const __m128i *) (b + len));
+		const uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(a_val, b_val));
+
+		if (mask != 0xFFFF) {
+			return len + (unsigned long) lz4_ctz64(~mask);
+		}
+
+		len += 16;
+	}
+
+	return lz4_match_len_scalar(a, b, len, len_limit);
+}
+
+LZ4_TARGET_SSE2 static void
+lz4_copy_sse2(unsigned char *dst, const unsigned char *src, unsigned long len)
+{
+	while (len >= 16) {
+		_mm_storeu_si128((__m128i *) dst, _mm_loadu_si128((const __m128i *) src));
+		dst += 16;
+		src += 16;
+		len -= 16;
+	}
+
+	memcpy(dst, src, len);
+}
+
+LZ4_TARGET_SSE2 static void
+lz4_match_copy_sse2(unsigned char *dst, unsigned long offs, unsigned long len)
+{
+	if (offs >= 16) {
+		const unsigned char *src = dst - offs;
+
+		while (len >= 16) {
+			_mm_storeu_si128((__m128i *) dst, _mm_loadu_si128((const __m128i *) src));
+			dst += 16;
+			src += 16;
+			len -= 16;
+		}
+	}
+
+	lz4_match_copy_scalar(dst, offs, len);
+}
+
+//
+// AVX2 kernels
+//
+
+LZ4_TARGET_AVX2 static unsigned long
+lz4_match_len_avx2(const unsigned char *a, const unsigned char *b,
+                   unsigned long len, unsigned long len_limit)
+{
+	while (len + 32 <= len_limit) {
+		const __m256i a_val = _mm256_loadu_si256((const __m256i *) (a + len));
+		const __m256i b_val = _mm256_loadu_si256((const __m256i *) (b + len));
+		const uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(a_val, b_val));
+
+		if (mask != UINT32_MAX) {
+			return len + (unsigned long) lz4_ctz64(~mask);
+		}
+
+		len += 32;
+	}
+
+	return lz4_match_len_sse2(a, b, len, len_limit);
+}
+
+LZ4_TARGET_AVX2 static void
+lz4_copy_avx2(unsigned char *dst, const unsigned char *src, unsigned long len)
+{
+	while (len >= 32) {
+		_mm256_storeu_si256((__m256i *) dst, _mm256_loadu_si256((const __m256i *) src));
+		dst += 32;
+		src += 32;
+		len -= 32;
+	}
+
+	lz4_copy_sse2(dst, src, len);
+}
+
+LZ4_TARGET_AVX2 static void
+lz4_match_copy_avx2(unsigned char *dst, unsigned long offs, unsigned long len)
+{
+	if (offs >= 32) {
+		const unsigned char *src = dst - offs;
+
+		while (len >= 32) {
+			_mm256_storeu_si256((__m256i *) dst, _mm256_loadu_si256((const __m256i *) src));
+			dst += 32;
+			src += 32;
+			len -= 32;
+		}
+	}
+
+	lz4_match_copy_sse2(dst, offs, len);
+}
+
+// Check if the CPU and operating system support kernel
+static int
+lz4_cpu_supports(int kernel)
+{
+#  if defined(_MSC_VER)
+	int regs[4];
+
+	__cpuid(regs, 0);
+
+	const int max_leaf = regs[0];
+
+	__cpuid(regs, 1);
+
+	const int has_sse2 = (regs[3] >> 26) & 1;
+	const int has_osxsave_avx = ((regs[2] >> 27) & 1) && ((regs[2] >> 28) & 1);
+	int has_avx2 = 0;
+
+	if (has_osxsave_avx && max_leaf >= 7 && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(regs, 7, 0);
+		has_avx2 = (regs[1] >> 5) & 1;
+	}
+#  else
+	__builtin_cpu_init();
+
+	const int has_sse2 = __builtin_cpu_supports("sse2");
+	const int has_avx2 = __builtin_cpu_supports("avx2");
+#  endif
+
+	switch (kernel) {
+	case LZ4_KERNEL_SCALAR:
+		return 1;
+	case LZ4_KERNEL_SSE2:
+		return has_sse2;
+	case LZ4_KERNEL_AVX2:
+		return has_sse2 && has_avx2;
+	default:
+		return 0;
+	}
+}
+
+#else
+
+static int
+lz4_cpu_supports(int kernel)
+{
+	return kernel == LZ4_KERNEL_SCALAR;
+}
+
+#endif /* LZ4_X86_KERNELS */
+
+static const struct lz4_kernels lz4_kernels_scalar = {
+	LZ4_KERNEL_SCALAR,
+	lz4_match_len_scalar,
+	lz4_copy_scalar,
+	lz4_match_copy_scalar
+};
+
+#if defined(LZ4_X86_KERNELS)
+static const struct lz4_kernels lz4_kernels_sse2 = {
+	LZ4_KERNEL_SSE2,
+	lz4_match_len_sse2,
+	lz4_copy_sse2,
+	lz4_match_copy_sse2
+};
+
+static const struct lz4_kernels lz4_kernels_avx2 = {
+	LZ4_KERNEL_AVX2,
+	lz4_match_len_avx2,
+	lz4_copy_avx2,
+	lz4_match_copy_avx2
+};
+#endif
+
+static const struct lz4_kernels *
+lz4_kernels_for(int kernel)
+{
+	switch (kernel) {
+#if defined(LZ4_X86_KERNELS)
+	case LZ4_KERNEL_SSE2:
+		return &lz4_kernels_sse2;
+	case LZ4_KERNEL_AVX2:
+		return &lz4_kernels_avx2;
+#endif
+	default:
+		return &lz4_kernels_scalar;
+	}
+}
+
+// Select the best kernels supported by the CPU
+static const struct lz4_kernels *
+lz4_kernels_detect(void)
+{
+	if (lz4_cpu_supports(LZ4_KERNEL_AVX2)) {
+		return lz4_kernels_for(LZ4_KERNEL_AVX2);
+	}
+
+	if (lz4_cpu_supports(LZ4_KERNEL_SSE2)) {
+		return lz4_kernels_for(LZ4_KERNEL_SSE2);
+	}
+
+	return &lz4_kernels_scalar;
+}
+
+// Kernels start out as scalar, and are replaced by the best kernels
+// supported by the CPU in lz4_kernels_init, which is called before any
+// kernels are used. Doing this once under a once-flag means lz4_kernels is
+// never written while other threads may be reading it.
+//
+const struct lz4_kernels *lz4_kernels = &lz4_kernels_scalar;
+
+static struct blz4_once lz4_kernels_once = BLZ4_ONCE_INIT;
+
+static void
+lz4_kernels_select(void)
+{
+	lz4_kernels = lz4_kernels_detect();
+}
+
+void
+lz4_kernels_init(void)
+{
+	blz4_once_call(&lz4_kernels_once, lz4_kernels_select);
+}
+
+int
+lz4_set_kernel(int kernel)
+{
+	// Detect first, so it does not replace the kernel selected here
+	lz4_kernels_init();
+
+	if (kernel == LZ4_KERNEL_AUTO) {
+		lz4_kernels = lz4_kernels_detect();
+		return lz4_kernels->kernel;
+	}
+
+	if (kernel < LZ4_KERNEL_SCALAR || kernel > LZ4_KERNEL_AVX2
+	 || !lz4_cpu_supports(kernel)) {
+		return -1;
+	}
+
+	lz4_kernels = lz4_kernels_for(kernel);
+
+	return kernel;
+}
+
+int
+lz4_get_kernel(void)
+{
+	lz4_kernels_init();
+
+	return lz4_kernels->kernel;
+}
+
+const char *
+lz4_kernel_name(int kernel)
+{
+	if (kernel < LZ4_KERNEL_AUTO || kernel > LZ4_KERNEL_AVX2) {
+		return NULL;
+	}
+
+	return lz4_kernel_names[kernel];
+}
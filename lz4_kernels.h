@@ -0,0 +1,65 @@
+//
+// blz4 - Example of LZ4 compression with BriefLZ algorithms
+//
+// Kernels selected at runtime based on CPU features
+//
+// Copyright (c) 2026 Joergen Ibsen
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must
+//      not claim that you wrote the original software. If you use this
+//      software in a product, an acknowledgment in the product
+//      documentation would be appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must
+//      not be misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//      distribution.
+//
+
+#ifndef LZ4_KERNELS_H_INCLUDED
+#define LZ4_KERNELS_H_INCLUDED
+
+#include "lz4.h"
+
+struct lz4_kernels {
+	// One of the LZ4_KERNEL_ values
+	int kernel;
+
+	// Get length of match between a and b, which are known to match in
+	// the first len bytes, up to a maximum of len_limit
+	unsigned long (*match_len)(const unsigned char *a, const unsigned char *b,
+	                           unsigned long len, unsigned long len_limit);
+
+	// Copy len bytes from src to dst, which do not overlap
+	void (*copy)(unsigned char *dst, const unsigned char *src,
+	             unsigned long len);
+
+	// Copy len bytes from offs bytes before dst to dst, where source and
+	// destination may overlap
+	void (*match_copy)(unsigned char *dst, unsigned long offs,
+	                   unsigned long len);
+};
+
+// Kernels in use.
+//
+// Functions that use the kernels must call lz4_kernels_init first.
+//
+extern LZ4_LOCAL const struct lz4_kernels *lz4_kernels;
+
+// Select the best kernels supported by the CPU, unless lz4_set_kernel has
+// been called. Only the first call does anything, and it is safe to call
+// from several threads at the same time.
+//
+LZ4_LOCAL void
+lz4_kernels_init(void);
+
+#endif /* LZ4_KERNELS_H_INCLUDED */
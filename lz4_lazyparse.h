@@ -0,0 +1,331 @@
+//
+// blz4 - Example of LZ4 compression with BriefLZ algorithms
+//
+// Lazy parse using hash chains
+//
+// Copyright (c) 2026 Joergen Ibsen
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must
+//      not claim that you wrote the original software. If you use this
+//      software in a product, an acknowledgment in the product
+//      documentation would be appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must
+//      not be misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//      distribution.
+//
+
+#ifndef LZ4_LAZYPARSE_H_INCLUDED
+#define LZ4_LAZYPARSE_H_INCLUDED
+
+// Number of positions kept in the hash chains, which must be a power of
+// two larger than the maximum offset.
+//
+#define LZ4_LAZYPARSE_WINDOW_SIZE (1UL << 16)
+
+static unsigned long
+lz4_lazyparse_window_size(size_t src_size)
+{
+	return src_size < LZ4_LAZYPARSE_WINDOW_SIZE ? (unsigned long) src_size : LZ4_LAZYPARSE_WINDOW_SIZE;
+}
+
+// Get size of the lookup used for lz4_fastparse_stretch, which is only
+// needed for input larger than a region.
+//
+static unsigned long
+lz4_lazyparse_stretch_size(size_t src_size)
+{
+	return src_size > LZ4_REGION_SIZE ? 1UL << LZ4_FASTPARSE_STRETCH_BITS : 0;
+}
+
+static size_t
+lz4_lazyparse_workmem_size(size_t src_size, int hash_bits)
+{
+	return (2 * (lz4_lazyparse_window_size(src_size)
+	           + (1UL << lz4_lookup_bits(src_size, hash_bits)))
+	      + lz4_lazyparse_stretch_size(src_size)) * sizeof(uint32_t);
+}
+
+// Hash chains of positions with the same hash of the next four or eight
+// bytes.
+//
+// The chains are kept in a sliding window indexed by position modulo
+// LZ4_LAZYPARSE_WINDOW_SIZE, which fits in cache where an entry for
+// every position of a large block would not. Since the search stops at
+// the first position that is too far back to match, we never follow a
+// link from an entry that has been reused.
+//
+struct lz4_lazyparse_chains {
+	uint32_t *lookup4;
+	uint32_t *prev4;
+	uint32_t *lookup8;
+	uint32_t *prev8;
+	int bits;
+	unsigned long next_insert;
+};
+
+// Search chain starting at pos for a match for cur longer than max_len,
+// checking at most max_depth positions.
+//
+static unsigned long
+lz4_lazyparse_search(const unsigned char *in, const uint32_t *prev, unsigned long pos,
+                     unsigned long cur, unsigned long max_len, unsigned long max_depth,
+                     unsigned long len_limit, const struct lz4_params *params,
+                     unsigned long *match_pos)
+{
+	const unsigned long window_mask = LZ4_LAZYPARSE_WINDOW_SIZE - 1;
+	const unsigned long accept_len = params->accept_len;
+	unsigned long num_chain = max_depth;
+
+	for (; pos != NO_MATCH_POS && num_chain--; pos = prev[pos & window_mask]) {
+		assert(pos < cur);
+
+		if (cur - pos > params->window_size) {
+			break;
+		}
+
+		// If next byte matches, so this has a chance to be a longer match
+		if (max_len < len_limit && in[pos + max_len] == in[cur + max_len]) {
+			// Find match len
+			const unsigned long len = lz4_match_len(&in[pos], &in[cur], 0, len_limit);
+
+			if (len > max_len) {
+				max_len = len;
+				*match_pos = pos;
+
+				if (len >= accept_len || len == len_limit) {
+					break;
+				}
+			}
+		}
+	}
+
+	return max_len;
+}
+
+// Find longest match for cur that is longer than min_len, updating hash
+// chains up to cur first.
+//
+// Most of the time of a search of the chain of four byte hashes is spent
+// on the many short matches of common strings. We search only the first
+// max_depth / 8 positions of it, and if that finds a match, search up to
+// max_depth positions of the chain of eight byte hashes for a longer one.
+// On data with few matches, that skips the second chain.
+//
+// Returns the length of the match found, or 0 if there is none.
+//
+static unsigned long
+lz4_lazyparse_find(const unsigned char *in, struct lz4_lazyparse_chains *chains,
+                   unsigned long cur, unsigned long min_len, unsigned long len_limit,
+                   const struct lz4_params *params, unsigned long *match_pos)
+{
+	const unsigned long window_mask = LZ4_LAZYPARSE_WINDOW_SIZE - 1;
+	const int bits = chains->bits;
+
+	// Update hash chains up to and including cur
+	for (unsigned long i = chains->next_insert; i <= cur; ++i) {
+		const unsigned long hash4 = lz4_hash4_bits(&in[i], bits);
+		const unsigned long hash8 = lz4_hash8_bits(&in[i], bits);
+		chains->prev4[i & window_mask] = chains->lookup4[hash4];
+		chains->lookup4[hash4] = i;
+		chains->prev8[i & window_mask] = chains->lookup8[hash8];
+		chains->lookup8[hash8] = i;
+	}
+
+	chains->next_insert = cur + 1;
+
+	const unsigned long depth4 = params->max_depth > 8 ? params->max_depth / 8 : 1;
+	unsigned long pos = NO_MATCH_POS;
+
+	const unsigned long len4 = lz4_lazyparse_search(in, chains->prev4, chains->prev4[cur & window_mask],
+	                                                cur, 3, depth4, len_limit, params, &pos);
+
+	if (len4 < 4) {
+		return 0;
+	}
+
+	unsigned long max_len = min_len;
+
+	if (len4 > min_len) {
+		max_len = len4;
+		*match_pos = pos;
+	}
+
+	if (max_len < params->accept_len) {
+		max_len = lz4_lazyparse_search(in, chains->prev8, chains->prev8[cur & window_mask],
+		                               cur, max_len, params->max_depth, len_limit,
+		                               params, match_pos);
+	}
+
+	return max_len > min_len ? max_len : 0;
+}
+
+// Lazy parse using hash chains.
+//
+// At each position we search the hash chain for the longest match. Before
+// taking it, we check if the next two positions have a longer match, in
+// which case we output a literal and continue from there instead.
+//
+// Matches of length accept_len or longer are taken immediately.
+//
+// This is similar to the lazy matching in zlib and LZ4HC.
+//
+static unsigned long
+lz4_pack_lazyparse(const void *src, void *dst, unsigned long src_size,
+                   unsigned long dict_size, void *workmem,
+                   const struct lz4_params *params)
+{
+	const unsigned char *const in = (const unsigned char *) src;
+	const unsigned long last_match_pos = src_size > 12 ? src_size - 12 : 0;
+	const unsigned long accept_len = params->accept_len;
+
+	// Check for empty input
+	if (src_size == dict_size) {
+		unsigned char *out = (unsigned char *) dst;
+		*out++ = 0;
+		return 1;
+	}
+
+	// Check for input without room for match
+	if (src_size - dict_size < 13) {
+		unsigned char *out = (unsigned char *) dst;
+		*out++ = (src_size - dict_size) << 4;
+		for (unsigned long i = dict_size; i < src_size; ++i) {
+			*out++ = in[i];
+		}
+		return 1 + src_size - dict_size;
+	}
+
+	const int bits = lz4_lookup_bits(src_size, params->hash_bits);
+	const unsigned long window_size = lz4_lazyparse_window_size(src_size);
+
+	struct lz4_lazyparse_chains chains;
+
+	chains.lookup4 = (uint32_t *) workmem;
+	chains.lookup8 = chains.lookup4 + (1UL << bits);
+	chains.prev4 = chains.lookup8 + (1UL << bits);
+	chains.prev8 = chains.prev4 + window_size;
+	chains.bits = bits;
+
+	uint32_t *const stretch_lookup = chains.prev8 + window_size;
+
+	// Next position to insert into hash chains, dictionary positions are
+	// inserted on the first search
+	chains.next_insert = 0;
+
+	// Initialize lookups
+	for (unsigned long i = 0; i < 2 * (1UL << bits); ++i) {
+		chains.lookup4[i] = NO_MATCH_POS;
+	}
+
+	unsigned char *out = (unsigned char *) dst;
+
+	// Start of literals not yet output
+	unsigned long next_lit = dict_size;
+
+	unsigned long cur = dict_size;
+
+	// Start of the input output since the last check, and the output
+	// size there, see lz4_region_shrinks
+	unsigned long region_cur = dict_size;
+	unsigned long region_size = 0;
+
+	while (cur <= last_match_pos) {
+		// At the end of each region, check if it shrank, and if not,
+		// compress the input with the fast parser a region at a time,
+		// until we get to a region that shrinks, which we go back and
+		// search
+		//
+		// The positions it covers are inserted into the hash chains
+		// on the next search.
+		//
+		if (cur - region_cur >= LZ4_REGION_SIZE) {
+			if (!lz4_region_shrinks(region_size, lz4_output_size((unsigned char *) dst, out, next_lit, cur),
+			                        cur - region_cur)) {
+				while (cur <= last_match_pos) {
+					unsigned char *const region_out = out;
+					const unsigned long region_next_lit = next_lit;
+
+					region_cur = cur;
+					region_size = lz4_output_size((unsigned char *) dst, out, next_lit, cur);
+
+					for (unsigned long i = 0; i < (1UL << LZ4_FASTPARSE_STRETCH_BITS); ++i) {
+						stretch_lookup[i] = NO_MATCH_POS;
+					}
+
+					out = lz4_fastparse_stretch(in, out, src_size, &cur, cur + LZ4_REGION_SIZE, &next_lit,
+					                            stretch_lookup, LZ4_FASTPARSE_STRETCH_BITS, 1,
+					                            params->window_size);
+
+					if (cur <= last_match_pos
+					 && lz4_region_shrinks(region_size, lz4_output_size((unsigned char *) dst, out, next_lit, cur),
+					                       cur - region_cur)) {
+						out = region_out;
+						next_lit = region_next_lit;
+						cur = region_cur;
+						break;
+					}
+				}
+			}
+
+			region_cur = cur;
+			region_size = lz4_output_size((unsigned char *) dst, out, next_lit, cur);
+
+			continue;
+		}
+
+		unsigned long pos = NO_MATCH_POS;
+		unsigned long len = lz4_lazyparse_find(in, &chains, cur, 3, src_size - cur - 5,
+		                                       params, &pos);
+
+		if (len == 0) {
+			++cur;
+			continue;
+		}
+
+		// Check if the next two positions have a longer match
+		for (int step = 0; step < 2 && len < accept_len && cur < last_match_pos; ++step) {
+			unsigned long next_pos = NO_MATCH_POS;
+			unsigned long next_len = lz4_lazyparse_find(in, &chains, cur + 1, len,
+			                                            src_size - cur - 6, params, &next_pos);
+
+			if (next_len == 0) {
+				break;
+			}
+
+			++cur;
+			len = next_len;
+			pos = next_pos;
+		}
+
+		// Extend match backwards over pending literals
+		while (cur > next_lit && pos > 0 && in[pos - 1] == in[cur - 1]) {
+			--cur;
+			--pos;
+			++len;
+		}
+
+		out = lz4_write_sequence(out, &in[next_lit], cur - next_lit, cur - pos, len);
+
+		cur += len;
+		next_lit = cur;
+	}
+
+	// Output last literals
+	out = lz4_write_sequence(out, &in[next_lit], src_size - next_lit, 0, 0);
+
+	// Return compressed size
+	return (unsigned long) (out - (unsigned char *) dst);
+}
+
+#endif /* LZ4_LAZYPARSE_H_INCLUDED */
@@ -28,35 +28,58 @@
 #ifndef LZ4_LEPARSE_H_INCLUDED
 #define LZ4_LEPARSE_H_INCLUDED
 
+// Get number of hash bits to use for input of src_size bytes.
+//
+// Small inputs use a lookup sized to the input, while large inputs use
+// the space of mpos and mlen, which is free while building hash chains,
+// for up to log2 of src_size bits. Both are limited to hash_bits.
+//
+static int
+lz4_leparse_bits(size_t src_size, int hash_bits)
+{
+	if (2 * src_size < ((size_t) 1 << LZ4_HASH_BITS)) {
+		return lz4_lookup_bits(src_size, hash_bits);
+	}
+
+	const int bits = lz4_log2((unsigned long) src_size);
+
+	return bits < hash_bits ? bits : hash_bits;
+}
+
 static size_t
-lz4_leparse_workmem_size(size_t src_size)
+lz4_leparse_workmem_size(size_t src_size, int hash_bits)
 {
-	return (LOOKUP_SIZE < 2 * src_size ? 3 * src_size : src_size + LOOKUP_SIZE)
+	const size_t lookup_size = (size_t) 1 << lz4_leparse_bits(src_size, hash_bits);
+
+	return (lookup_size < 2 * src_size ? 3 * src_size : src_size + lookup_size)
 	     * sizeof(uint32_t);
 }
 
 static unsigned long
-lz4_pack_leparse(const void *src, void *dst, unsigned long src_size, void *workmem,
-                 const unsigned long max_depth, const unsigned long accept_len)
+lz4_pack_leparse(const void *src, void *dst, unsigned long src_size,
+                 unsigned long dict_size, void *workmem,
+                 const struct lz4_params *params, struct lz4_pack_stats *stats)
 {
 	const unsigned char *const in = (const unsigned char *) src;
 	const unsigned long last_match_pos = src_size > 12 ? src_size - 12 : 0;
+	const unsigned long max_depth = params->max_depth;
+	const unsigned long accept_len = params->accept_len;
 
 	// Check for empty input
-	if (src_size == 0) {
+	if (src_size == dict_size) {
 		unsigned char *out = (unsigned char *) dst;
 		*out++ = 0;
 		return 1;
 	}
 
 	// Check for input without room for match
-	if (src_size < 13) {
+	if (src_size - dict_size < 13) {
 		unsigned char *out = (unsigned char *) dst;
-		*out++ = src_size << 4;
-		for (unsigned long i = 0; i < src_size; ++i) {
+		*out++ = (src_size - dict_size) << 4;
+		for (unsigned long i = dict_size; i < src_size; ++i) {
 			*out++ = in[i];
 		}
-		return 1 + src_size;
+		return 1 + src_size - dict_size;
 	}
 
 	// With a bit of careful ordering we can fit in 3 * src_size words.
@@ -75,8 +98,15 @@ lz4_pack_leparse(const void *src, void *dst, unsigned long src_size, void *workm
 	uint32_t *const cost = prev;
 	uint32_t *const lookup = mpos;
 
+	// Counters for stats, kept locally so they cost little when unused
+	unsigned long long nodes_visited = 0;
+	unsigned long long bytes_compared = 0;
+	unsigned long long accept_cutoffs = 0;
+
+	double time_start = lz4_stats_time(stats);
+
 	// Phase 1: Build hash chains
-	const int bits = 2 * src_size < LOOKUP_SIZE ? LZ4_HASH_BITS : lz4_log2(src_size);
+	const int bits = lz4_leparse_bits(src_size, params->hash_bits);
 
 	// Initialize lookup
 	for (unsigned long i = 0; i < (1UL << bits); ++i) {
@@ -100,8 +130,13 @@ lz4_pack_leparse(const void *src, void *dst, unsigned long src_size, void *workm
 	}
 	cost[src_size] = 0;
 
+	// The first position has no matches unless there is a dictionary
+	const unsigned long first_match_pos = dict_size > 0 ? dict_size : 1;
+
+	double time_build = lz4_stats_time(stats);
+
 	// Phase 2: Find lowest cost path from each position to end
-	for (unsigned long cur = last_match_pos; cur > 0; --cur) {
+	for (unsigned long cur = last_match_pos; cur >= first_match_pos; --cur) {
 		// Since we updated prev to the end in the first phase, we
 		// do not need to hash, but can simply look up the previous
 		// position directly.
@@ -135,18 +170,19 @@ lz4_pack_leparse(const void *src, void *dst, unsigned long src_size, void *workm
 
 		// Go through the chain of prev matches
 		for (; pos != NO_MATCH_POS && num_chain--; pos = prev[pos]) {
-			if (cur - pos > 65535) {
+			if (cur - pos > params->window_size) {
 				break;
 			}
 
 			unsigned long len = 0;
 
+			++nodes_visited;
+
 			// If next byte matches, so this has a chance to be a longer match
 			if (max_len < len_limit && in[pos + max_len] == in[cur + max_len]) {
 				// Find match len
-				while (len < len_limit && in[pos + len] == in[cur + len]) {
-					++len;
-				}
+				len = lz4_match_len(&in[pos], &in[cur], len, len_limit);
+				bytes_compared += len;
 			}
 
 			// Extend current match if possible
@@ -181,7 +217,7 @@ lz4_pack_leparse(const void *src, void *dst, unsigned long src_size, void *workm
 					mlen[cur] = min_cost_len;
 
 					// Left-extend current match if possible
-					if (pos > 0 && in[pos - 1] == in[cur - 1]) {
+					if (cur > dict_size && pos > 0 && in[pos - 1] == in[cur - 1]) {
 						do {
 							--cur;
 							--pos;
@@ -192,25 +228,30 @@ lz4_pack_leparse(const void *src, void *dst, unsigned long src_size, void *workm
 							cost[cur] = cost_here;
 							mpos[cur] = pos;
 							mlen[cur] = min_cost_len;
-						} while (pos > 0 && in[pos - 1] == in[cur - 1]);
+						} while (cur > dict_size && pos > 0 && in[pos - 1] == in[cur - 1]);
 						break;
 					}
 				}
 			}
 
 			if (len >= accept_len || len == len_limit) {
+				accept_cutoffs += len < len_limit;
 				break;
 			}
 		}
 	}
 
-	mpos[0] = 0;
-	mlen[0] = 1;
+	double time_parse = lz4_stats_time(stats);
+
+	if (dict_size == 0) {
+		mpos[0] = 0;
+		mlen[0] = 1;
+	}
 
 	unsigned char *out = (unsigned char *) dst;
 
 	// Phase 3: Output compressed data, following lowest cost path
-	for (unsigned long i = 0; i < src_size; i += mlen[i]) {
+	for (unsigned long i = dict_size; i < src_size; i += mlen[i]) {
 		unsigned long next_lit = i;
 		unsigned long nlit = 0;
 
@@ -267,6 +308,15 @@ lz4_pack_leparse(const void *src, void *dst, unsigned long src_size, void *workm
 		*token_out = (nlit << 4) | (len - 4);
 	}
 
+	if (stats != NULL) {
+		stats->time_build += time_build - time_start;
+		stats->time_parse += time_parse - time_build;
+		stats->time_emit += lz4_stats_time(stats) - time_parse;
+		stats->nodes_visited += nodes_visited;
+		stats->bytes_compared += bytes_compared;
+		stats->accept_cutoffs += accept_cutoffs;
+	}
+
 	// Return compressed size
 	return (unsigned long) (out - (unsigned char *) dst);
 }
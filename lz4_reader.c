@@ -0,0 +1,769 @@
+/*
+ * blz4 - Example of LZ4 compression with BriefLZ algorithms
+ *
+ * Random access reader using seek index
+ *
+ * Copyright (c) 2026 Joergen Ibsen
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must
+ *      not claim that you wrote the original software. If you use this
+ *      software in a product, an acknowledgment in the product
+ *      documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must
+ *      not be misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *      distribution.
+ */
+
+#ifdef _MSC_VER
+#  define _CRT_SECURE_NO_WARNINGS
+#else
+#  define _FILE_OFFSET_BITS 64
+#  define _POSIX_C_SOURCE 200112L
+#  define _fseeki64 fseeko
+#  define _ftelli64 ftello
+#endif
+
+#include "blz4_thread.h"
+#include "lz4.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Stored bit in frame block header.
+ */
+#define LZ4_FRAME_BLOCK_UNCOMPRESSED (0x80000000UL)
+
+/*
+ * Largest block size accepted in index, which is the block size of the
+ * legacy format.
+ */
+#define LZ4_READER_BLOCK_SIZE_MAX (8 * 1024 * 1024UL)
+
+#define LZ4_READER_NO_ENTRY (-1L)
+
+/*
+ * Cache entry holding a decompressed block.
+ */
+struct lz4_reader_entry {
+	unsigned char *data;            /* Decompressed block, allocated on use */
+	long block;                     /* Block held, or LZ4_READER_NO_ENTRY */
+	unsigned long refs;             /* Number of reads copying from entry */
+	unsigned long long last_used;   /* Time of last use, for LRU */
+	int loading;                    /* Block is being read into data */
+	int failed;                     /* Reading block failed */
+};
+
+/*
+ * Open file and buffers used by one read at a time to read and
+ * decompress blocks.
+ */
+struct lz4_reader_io {
+	FILE *file;
+	unsigned char *packed;          /* Compressed block */
+	unsigned char *data;            /* Decompressed block, allocated on use */
+	struct lz4_reader_io *next;     /* Next unused handle */
+};
+
+/*
+ * The mutex protects the cache, statistics and list of unused handles,
+ * and is never held while reading or decompressing.
+ *
+ * A read that misses the cache reserves an entry for the block, marks it
+ * as loading, and fills it with the mutex released, using a handle of its
+ * own. Other reads of the block wait on the condition variable until it
+ * is loaded. Since each handle has its own file and buffers, misses on
+ * different blocks are read and decompressed in parallel. Handles are
+ * opened when no unused one is available, so there are as many as the
+ * most reads that have missed at the same time.
+ */
+struct lz4_reader {
+	char *filename;
+	unsigned long long size;        /* Size of decompressed data */
+	unsigned long num_blocks;
+	unsigned long block_max;        /* Maximum size of decompressed block */
+	unsigned long packed_max;       /* Maximum size of compressed block */
+	unsigned long flags;            /* LZ4_INDEX_ flags */
+	unsigned long long *offsets;    /* Decompressed and file offset pairs */
+	struct lz4_reader_io *free_io;  /* Unused handles */
+	struct lz4_reader_entry *entries;
+	unsigned long num_entries;
+	long *block_entry;              /* Cache entry of each block, or -1 */
+	unsigned long long time;        /* Incremented on each use of entry */
+	struct lz4_reader_stats stats;
+	struct blz4_mutex mutex;
+	struct blz4_cond loaded;        /* Signalled when entry is loaded */
+	int has_mutex;
+};
+
+static unsigned long
+lz4_read_le32(const unsigned char *p)
+{
+	return ((unsigned long) p[0])
+	     | ((unsigned long) p[1] << 8)
+	     | ((unsigned long) p[2] << 16)
+	     | ((unsigned long) p[3] << 24);
+}
+
+static unsigned long long
+lz4_read_le64(const unsigned char *p)
+{
+	return (unsigned long long) lz4_read_le32(p)
+	     | ((unsigned long long) lz4_read_le32(p + 4) << 32);
+}
+
+/*
+ * Read seek index from the end of `file`, returning 0 on success.
+ */
+static int
+lz4_reader_read_index(struct lz4_reader *reader, FILE *file)
+{
+	unsigned char trailer[LZ4_INDEX_TRAILER_SIZE];
+	unsigned char *entries = NULL;
+	unsigned long long file_size;
+	unsigned long long index_size;
+	unsigned long long prev_offs = 0;
+	unsigned long long prev_file_offs = 0;
+	unsigned long i;
+	int res = -1;
+
+	if (_fseeki64(file, 0, SEEK_END) != 0) {
+		return -1;
+	}
+
+	{
+		long long pos = (long long) _ftelli64(file);
+
+		if (pos < 8 + LZ4_INDEX_TRAILER_SIZE) {
+			return -1;
+		}
+
+		file_size = (unsigned long long) pos;
+	}
+
+	/* Read and check trailer */
+	if (_fseeki64(file, -LZ4_INDEX_TRAILER_SIZE, SEEK_END) != 0
+	 || fread(trailer, 1, LZ4_INDEX_TRAILER_SIZE, file) != LZ4_INDEX_TRAILER_SIZE
+	 || lz4_read_le32(trailer + 20) != LZ4_INDEX_ID) {
+		return -1;
+	}
+
+	reader->size = lz4_read_le64(trailer);
+	reader->num_blocks = lz4_read_le32(trailer + 8);
+	reader->block_max = lz4_read_le32(trailer + 12);
+	reader->flags = lz4_read_le32(trailer + 16);
+
+	if (reader->block_max == 0 || reader->block_max > LZ4_READER_BLOCK_SIZE_MAX) {
+		return -1;
+	}
+
+	/* Frame blocks that do not shrink are stored */
+	reader->packed_max = reader->flags & LZ4_INDEX_FRAME_BLOCKS
+	                   ? reader->block_max
+	                   : lz4_max_packed_size(reader->block_max);
+
+	index_size = (unsigned long long) reader->num_blocks * LZ4_INDEX_ENTRY_SIZE
+	           + LZ4_INDEX_TRAILER_SIZE;
+
+	if (index_size + 8 > file_size) {
+		return -1;
+	}
+
+	/* Read and check skippable frame header and entries */
+	if ((entries = (unsigned char *) malloc((size_t) index_size)) == NULL
+	 || (reader->offsets = (unsigned long long *) malloc(2 * (reader->num_blocks + 1) * sizeof(reader->offsets[0]))) == NULL
+	 || _fseeki64(file, (long long) (file_size - index_size - 8), SEEK_SET) != 0
+	 || fread(entries, 1, 8, file) != 8
+	 || lz4_read_le32(entries) != LZ4_INDEX_MAGIC
+	 || lz4_read_le32(entries + 4) != index_size
+	 || fread(entries, 1, (size_t) index_size, file) != index_size) {
+		goto out;
+	}
+
+	for (i = 0; i < reader->num_blocks; ++i) {
+		unsigned long long offs = lz4_read_le64(entries + i * LZ4_INDEX_ENTRY_SIZE);
+		unsigned long long file_offs = lz4_read_le64(entries + i * LZ4_INDEX_ENTRY_SIZE + 8);
+
+		/* Blocks must be in order, and not larger than maximum */
+		if ((i == 0 && offs != 0)
+		 || (i > 0 && (offs <= prev_offs || offs - prev_offs > reader->block_max
+		            || file_offs <= prev_file_offs))
+		 || file_offs >= file_size - index_size - 8) {
+			goto out;
+		}
+
+		reader->offsets[2 * i] = offs;
+		reader->offsets[2 * i + 1] = file_offs;
+
+		prev_offs = offs;
+		prev_file_offs = file_offs;
+	}
+
+	/* Sentinel with end of data */
+	if ((reader->num_blocks == 0 && reader->size != 0)
+	 || (reader->num_blocks > 0 && (reader->size <= prev_offs
+	                             || reader->size - prev_offs > reader->block_max))) {
+		goto out;
+	}
+
+	reader->offsets[2 * reader->num_blocks] = reader->size;
+	reader->offsets[2 * reader->num_blocks + 1] = file_size - index_size - 8;
+
+	res = 0;
+
+out:
+	free(entries);
+
+	return res;
+}
+
+/*
+ * Free handle and close its file.
+ */
+static void
+lz4_reader_io_free(struct lz4_reader_io *io)
+{
+	if (io->file != NULL) {
+		fclose(io->file);
+	}
+
+	free(io->data);
+	free(io->packed);
+	free(io);
+}
+
+/*
+ * Get unused handle, opening a new one if there is none.
+ *
+ * Returns NULL on error. Must be called without mutex held.
+ */
+static struct lz4_reader_io *
+lz4_reader_io_get(struct lz4_reader *reader)
+{
+	struct lz4_reader_io *io;
+
+	blz4_mutex_lock(&reader->mutex);
+
+	if ((io = reader->free_io) != NULL) {
+		reader->free_io = io->next;
+	}
+
+	blz4_mutex_unlock(&reader->mutex);
+
+	if (io != NULL) {
+		return io;
+	}
+
+	if ((io = (struct lz4_reader_io *) calloc(1, sizeof(*io))) == NULL) {
+		return NULL;
+	}
+
+	if ((io->file = fopen(reader->filename, "rb")) == NULL
+	 || (io->packed = (unsigned char *) malloc(reader->packed_max)) == NULL) {
+		lz4_reader_io_free(io);
+		return NULL;
+	}
+
+	return io;
+}
+
+/*
+ * Return handle to list of unused handles. Must be called without mutex
+ * held.
+ */
+static void
+lz4_reader_io_put(struct lz4_reader *reader, struct lz4_reader_io *io)
+{
+	blz4_mutex_lock(&reader->mutex);
+
+	io->next = reader->free_io;
+	reader->free_io = io;
+
+	blz4_mutex_unlock(&reader->mutex);
+}
+
+struct lz4_reader *
+lz4_reader_open(const char *filename, unsigned long cache_blocks)
+{
+	struct lz4_reader *reader;
+	struct lz4_reader_io *io;
+	size_t name_len = strlen(filename);
+	unsigned long i;
+
+	if ((reader = (struct lz4_reader *) calloc(1, sizeof(*reader))) == NULL) {
+		return NULL;
+	}
+
+	blz4_mutex_init(&reader->mutex);
+	blz4_cond_init(&reader->loaded);
+	reader->has_mutex = 1;
+
+	if ((reader->filename = (char *) malloc(name_len + 1)) == NULL
+	 || (io = (struct lz4_reader_io *) calloc(1, sizeof(*io))) == NULL) {
+		lz4_reader_close(reader);
+		return NULL;
+	}
+
+	memcpy(reader->filename, filename, name_len + 1);
+
+	/* Keep file used to read index as first handle */
+	reader->free_io = io;
+
+	if ((io->file = fopen(filename, "rb")) == NULL
+	 || lz4_reader_read_index(reader, io->file) != 0
+	 || (io->packed = (unsigned char *) malloc(reader->packed_max)) == NULL) {
+		lz4_reader_close(reader);
+		return NULL;
+	}
+
+	/* No point in caching more blocks than there are */
+	if (cache_blocks > reader->num_blocks) {
+		cache_blocks = reader->num_blocks;
+	}
+
+	if (cache_blocks > 0) {
+		if ((reader->entries = (struct lz4_reader_entry *) calloc(cache_blocks, sizeof(reader->entries[0]))) == NULL
+		 || (reader->block_entry = (long *) malloc(reader->num_blocks * sizeof(reader->block_entry[0]))) == NULL) {
+			lz4_reader_close(reader);
+			return NULL;
+		}
+
+		reader->num_entries = cache_blocks;
+
+		for (i = 0; i < cache_blocks; ++i) {
+			reader->entries[i].block = LZ4_READER_NO_ENTRY;
+		}
+
+		for (i = 0; i < reader->num_blocks; ++i) {
+			reader->block_entry[i] = LZ4_READER_NO_ENTRY;
+		}
+	}
+
+	return reader;
+}
+
+void
+lz4_reader_close(struct lz4_reader *reader)
+{
+	if (reader == NULL) {
+		return;
+	}
+
+	while (reader->free_io != NULL) {
+		struct lz4_reader_io *io = reader->free_io;
+
+		reader->free_io = io->next;
+
+		lz4_reader_io_free(io);
+	}
+
+	if (reader->has_mutex) {
+		blz4_cond_destroy(&reader->loaded);
+		blz4_mutex_destroy(&reader->mutex);
+	}
+
+	if (reader->entries != NULL) {
+		unsigned long i;
+
+		for (i = 0; i < reader->num_entries; ++i) {
+			free(reader->entries[i].data);
+		}
+	}
+
+	free(reader->block_entry);
+	free(reader->entries);
+	free(reader->offsets);
+	free(reader->filename);
+	free(reader);
+}
+
+unsigned long long
+lz4_reader_size(const struct lz4_reader *reader)
+{
+	return reader->size;
+}
+
+void
+lz4_reader_get_stats(struct lz4_reader *reader, struct lz4_reader_stats *stats)
+{
+	blz4_mutex_lock(&reader->mutex);
+	*stats = reader->stats;
+	blz4_mutex_unlock(&reader->mutex);
+}
+
+/*
+ * Find index of block containing decompressed offset `offs`, which must
+ * be less than the size of the decompressed data.
+ */
+static unsigned long
+lz4_reader_find_block(const struct lz4_reader *reader, unsigned long long offs)
+{
+	unsigned long lo = 0;
+	unsigned long hi = reader->num_blocks;
+
+	/* Find last block starting at or before offs */
+	while (hi - lo > 1) {
+		const unsigned long mid = lo + (hi - lo) / 2;
+
+		if (reader->offsets[2 * mid] <= offs) {
+			lo = mid;
+		}
+		else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/*
+ * Read compressed block `block` using `io` and decompress its first
+ * `target` bytes into `out`.
+ *
+ * Returns 0 on success. Must be called without mutex held.
+ */
+static int
+lz4_reader_load_block(const struct lz4_reader *reader, struct lz4_reader_io *io,
+                      unsigned long block, unsigned long target,
+                      unsigned char *out)
+{
+	const unsigned long long file_offs = reader->offsets[2 * block + 1];
+	const unsigned long block_size = (unsigned long) (reader->offsets[2 * block + 2]
+	                                                - reader->offsets[2 * block]);
+	unsigned char header[4];
+	unsigned long block_header;
+	unsigned long packed_size;
+
+	if (_fseeki64(io->file, (long long) file_offs, SEEK_SET) != 0
+	 || fread(header, 1, 4, io->file) != 4) {
+		return -1;
+	}
+
+	block_header = lz4_read_le32(header);
+	packed_size = block_header;
+
+	if (reader->flags & LZ4_INDEX_FRAME_BLOCKS) {
+		packed_size &= ~LZ4_FRAME_BLOCK_UNCOMPRESSED;
+	}
+
+	/* Block must be within the data covered by the index */
+	if (packed_size > reader->packed_max
+	 || packed_size + 4ULL > reader->offsets[2 * block + 3] - file_offs
+	 || fread(io->packed, 1, packed_size, io->file) != packed_size) {
+		return -1;
+	}
+
+	/* Check block checksum */
+	if (reader->flags & LZ4_INDEX_BLOCK_CHECKSUM) {
+		if (fread(header, 1, 4, io->file) != 4
+		 || lz4_read_le32(header) != lz4_xxh32(io->packed, packed_size, 0)) {
+			return -1;
+		}
+	}
+
+	/* Stored block */
+	if ((reader->flags & LZ4_INDEX_FRAME_BLOCKS)
+	 && (block_header & LZ4_FRAME_BLOCK_UNCOMPRESSED)) {
+		if (packed_size != block_size) {
+			return -1;
+		}
+
+		memcpy(out, io->packed, target);
+
+		return 0;
+	}
+
+	/* Decompress only as much of the block as needed */
+	if (lz4_depack_partial(io->packed, out, packed_size, target) != target) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Get cache entry holding block and pin it, reserving an entry for it if
+ * it is not in the cache.
+ *
+ * If the entry is reserved, `*load` is set to 1 and the entry is marked
+ * as loading, and the caller must load the block into it.
+ *
+ * Returns index of entry, LZ4_READER_NO_ENTRY if there is no unpinned
+ * entry to reserve, or -2 on error. Must be called with mutex held.
+ */
+static long
+lz4_reader_get_entry(struct lz4_reader *reader, unsigned long block, int *load)
+{
+	struct lz4_reader_entry *entry;
+	long victim = LZ4_READER_NO_ENTRY;
+	unsigned long i;
+
+	*load = 0;
+
+	if (reader->num_entries == 0) {
+		++reader->stats.misses;
+		return LZ4_READER_NO_ENTRY;
+	}
+
+	/* Check if block is in cache, or being loaded by another read */
+	if (reader->block_entry[block] != LZ4_READER_NO_ENTRY) {
+		entry = &reader->entries[reader->block_entry[block]];
+
+		++reader->stats.hits;
+		++entry->refs;
+		entry->last_used = ++reader->time;
+
+		return reader->block_entry[block];
+	}
+
+	++reader->stats.misses;
+
+	/*
+	 * Find least recently used entry that is not pinned. The cache is
+	 * small, and a miss decompresses a block, so a linear search is fine.
+	 */
+	for (i = 0; i < reader->num_entries; ++i) {
+		if (reader->entries[i].refs == 0
+		 && (victim == LZ4_READER_NO_ENTRY
+		  || reader->entries[i].last_used < reader->entries[victim].last_used)) {
+			victim = (long) i;
+		}
+	}
+
+	if (victim == LZ4_READER_NO_ENTRY) {
+		return LZ4_READER_NO_ENTRY;
+	}
+
+	entry = &reader->entries[victim];
+
+	/* Evict block held by entry */
+	if (entry->block != LZ4_READER_NO_ENTRY) {
+		reader->block_entry[entry->block] = LZ4_READER_NO_ENTRY;
+		entry->block = LZ4_READER_NO_ENTRY;
+		++reader->stats.evictions;
+	}
+
+	if (entry->data == NULL
+	 && (entry->data = (unsigned char *) malloc(reader->block_max)) == NULL) {
+		return -2;
+	}
+
+	entry->block = (long) block;
+	entry->refs = 1;
+	entry->last_used = ++reader->time;
+	entry->loading = 1;
+	entry->failed = 0;
+	reader->block_entry[block] = victim;
+
+	*load = 1;
+
+	return victim;
+}
+
+/*
+ * Load whole block into entry `e` reserved by lz4_reader_get_entry, so
+ * later reads of any part of it hit, and wake reads waiting for it.
+ *
+ * Returns 0 on success. Must be called without mutex held.
+ */
+static int
+lz4_reader_load_entry(struct lz4_reader *reader, long e, unsigned long block)
+{
+	struct lz4_reader_entry *entry = &reader->entries[e];
+	struct lz4_reader_io *io = lz4_reader_io_get(reader);
+	int res = -1;
+
+	if (io != NULL) {
+		res = lz4_reader_load_block(reader, io, block,
+		                            (unsigned long) (reader->offsets[2 * block + 2]
+		                                           - reader->offsets[2 * block]),
+		                            entry->data);
+
+		lz4_reader_io_put(reader, io);
+	}
+
+	blz4_mutex_lock(&reader->mutex);
+
+	entry->loading = 0;
+
+	/* Remove failed block from cache, so the next read tries again */
+	if (res != 0) {
+		entry->failed = 1;
+		entry->block = LZ4_READER_NO_ENTRY;
+		entry->last_used = 0;
+		reader->block_entry[block] = LZ4_READER_NO_ENTRY;
+	}
+
+	blz4_cond_broadcast(&reader->loaded);
+	blz4_mutex_unlock(&reader->mutex);
+
+	return res;
+}
+
+/*
+ * Decompress the first `target` bytes of block into the buffer of a
+ * handle, without using the cache, and copy bytes from `begin` to
+ * `target` to `out`.
+ *
+ * Returns 0 on success. Must be called without mutex held.
+ */
+static int
+lz4_reader_read_uncached(struct lz4_reader *reader, unsigned long block,
+                         unsigned long begin, unsigned long target,
+                         unsigned char *out)
+{
+	struct lz4_reader_io *io = lz4_reader_io_get(reader);
+	int res = -1;
+
+	if (io == NULL) {
+		return -1;
+	}
+
+	if ((io->data != NULL
+	  || (io->data = (unsigned char *) malloc(reader->block_max)) != NULL)
+	 && lz4_reader_load_block(reader, io, block, target, io->data) == 0) {
+		memcpy(out, io->data + begin, target - begin);
+		res = 0;
+	}
+
+	lz4_reader_io_put(reader, io);
+
+	return res;
+}
+
+unsigned long
+lz4_reader_read(struct lz4_reader *reader, void *dst,
+                unsigned long long offset, unsigned long size)
+{
+	unsigned char *out = (unsigned char *) dst;
+	unsigned long num_read = 0;
+	unsigned long block;
+
+	/* Clamp range to decompressed data */
+	if (offset >= reader->size) {
+		return 0;
+	}
+
+	if (size > reader->size - offset) {
+		size = (unsigned long) (reader->size - offset);
+	}
+
+	block = lz4_reader_find_block(reader, offset);
+
+	/* Decompress each block overlapping range */
+	while (num_read < size) {
+		const unsigned long long block_start = reader->offsets[2 * block];
+		const unsigned long block_size = (unsigned long) (reader->offsets[2 * block + 2]
+		                                                - block_start);
+		const unsigned long begin = (unsigned long) (offset + num_read - block_start);
+		unsigned long end = block_size;
+
+		if (size - num_read < end - begin) {
+			end = begin + (size - num_read);
+		}
+
+		long e;
+		int load;
+		int failed = 0;
+
+		blz4_mutex_lock(&reader->mutex);
+
+		e = lz4_reader_get_entry(reader, block, &load);
+
+		/* Wait for block if another read is loading it */
+		if (e >= 0 && !load) {
+			while (reader->entries[e].loading) {
+				blz4_cond_wait(&reader->loaded, &reader->mutex);
+			}
+
+			failed = reader->entries[e].failed;
+		}
+
+		blz4_mutex_unlock(&reader->mutex);
+
+		if (e >= 0) {
+			if (load) {
+				failed = lz4_reader_load_entry(reader, e, block) != 0;
+			}
+
+			/* Copy from pinned entry without holding the mutex */
+			if (!failed) {
+				memcpy(out + num_read, reader->entries[e].data + begin, end - begin);
+			}
+
+			blz4_mutex_lock(&reader->mutex);
+			--reader->entries[e].refs;
+			blz4_mutex_unlock(&reader->mutex);
+
+			if (failed) {
+				return LZ4_ERROR;
+			}
+		}
+		else {
+			/* Decompress only what is needed into uncached buffer */
+			if (e != LZ4_READER_NO_ENTRY
+			 || lz4_reader_read_uncached(reader, block, begin, end, out + num_read) != 0) {
+				return LZ4_ERROR;
+			}
+		}
+
+		num_read += end - begin;
+
+		++block;
+	}
+
+	return num_read;
+}
+
+/*
+ * clang -g -O1 -fsanitize=fuzzer,address -DLZ4_FUZZING -c lz4_reader.c
+ * clang -g -O1 -fsanitize=fuzzer,address lz4_reader.o lz4.c lz4_depack.c lz4_kernels.c lz4_xxhash.c -lpthread
+ *
+ * The fuzzer input is written to a temporary file, and the seek index
+ * read from the end of it.
+ */
+#if defined(LZ4_FUZZING)
+#include <stddef.h>
+#include <stdint.h>
+
+extern int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct lz4_reader reader;
+	FILE *file;
+	unsigned long i;
+
+	if ((file = tmpfile()) == NULL) { abort(); }
+	if (fwrite(data, 1, size, file) != size) { abort(); }
+
+	memset(&reader, 0, sizeof(reader));
+
+	if (lz4_reader_read_index(&reader, file) == 0) {
+		/* Offsets increase, and blocks are within the limits */
+		for (i = 0; i < reader.num_blocks; ++i) {
+			if (reader.offsets[2 * i + 2] <= reader.offsets[2 * i]
+			 || reader.offsets[2 * i + 2] - reader.offsets[2 * i] > reader.block_max
+			 || reader.offsets[2 * i + 3] <= reader.offsets[2 * i + 1]
+			 || lz4_reader_find_block(&reader, reader.offsets[2 * i]) != i) { abort(); }
+		}
+		if (reader.offsets[2 * reader.num_blocks] != reader.size
+		 || reader.offsets[2 * reader.num_blocks + 1] > size) { abort(); }
+	}
+
+	free(reader.offsets);
+	fclose(file);
+	return 0;
+}
+#endif
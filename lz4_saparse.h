@@ -0,0 +1,725 @@
+//
+// blz4 - Example of LZ4 compression with BriefLZ algorithms
+//
+// Forwards dynamic programming parse using a suffix array
+//
+// Copyright (c) 2026 Joergen Ibsen
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must
+//      not claim that you wrote the original software. If you use this
+//      software in a product, an acknowledgment in the product
+//      documentation would be appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must
+//      not be misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//      distribution.
+//
+
+#ifndef LZ4_SAPARSE_H_INCLUDED
+#define LZ4_SAPARSE_H_INCLUDED
+
+#define LZ4_SA_EMPTY ((uint32_t) -1)
+
+// Work per position above which we stop the binary tree search and use
+// the suffix array, counting each node visited and each 64 bytes compared.
+//
+// On most data the trees do less than 20, and are several times faster
+// than building the suffix array. On long runs and repeated data, they
+// do hundreds.
+//
+#ifndef LZ4_SAPARSE_MAX_TREE_WORK
+#  define LZ4_SAPARSE_MAX_TREE_WORK 40
+#endif
+
+// Maximum number of levels in the set of window positions, enough for
+// 2^32 elements with 32 bits per word.
+//
+#define LZ4_SA_SET_MAX_DEPTH 7
+
+// Get character i of the string being sorted.
+//
+// At the top level this is the input with each byte increased by one and
+// a virtual sentinel 0 at the end. In recursion it is the reduced string
+// of names, which already ends in a unique smallest name.
+//
+static uint32_t
+lz4_sa_chr(const unsigned char *s8, const uint32_t *s32, uint32_t n, uint32_t i)
+{
+	if (s8 != NULL) {
+		return i == n - 1 ? 0 : (uint32_t) s8[i] + 1;
+	}
+
+	return s32[i];
+}
+
+// Get type of suffix i, 1 for S-type and 0 for L-type
+static int
+lz4_sa_type(const uint32_t *t, uint32_t i)
+{
+	return (t[i >> 5] >> (i & 31)) & 1;
+}
+
+static int
+lz4_sa_is_lms(const uint32_t *t, uint32_t i)
+{
+	return i != LZ4_SA_EMPTY && i > 0 && lz4_sa_type(t, i) && !lz4_sa_type(t, i - 1);
+}
+
+// Compute start or end of each bucket
+static void
+lz4_sa_buckets(const unsigned char *s8, const uint32_t *s32, uint32_t n,
+               uint32_t *bkt, uint32_t k, int end)
+{
+	uint32_t sum = 0;
+
+	for (uint32_t i = 0; i <= k; ++i) {
+		bkt[i] = 0;
+	}
+
+	for (uint32_t i = 0; i < n; ++i) {
+		bkt[lz4_sa_chr(s8, s32, n, i)]++;
+	}
+
+	for (uint32_t i = 0; i <= k; ++i) {
+		sum += bkt[i];
+		bkt[i] = end ? sum : sum - bkt[i];
+	}
+}
+
+// Induce L-type suffixes from sorted suffixes, scanning left to right
+static void
+lz4_sa_induce_l(const unsigned char *s8, const uint32_t *s32, uint32_t *sa,
+                const uint32_t *t, uint32_t n, uint32_t *bkt, uint32_t k)
+{
+	lz4_sa_buckets(s8, s32, n, bkt, k, 0);
+
+	for (uint32_t i = 0; i < n; ++i) {
+		if (sa[i] != LZ4_SA_EMPTY && sa[i] > 0) {
+			const uint32_t j = sa[i] - 1;
+
+			if (!lz4_sa_type(t, j)) {
+				sa[bkt[lz4_sa_chr(s8, s32, n, j)]++] = j;
+			}
+		}
+	}
+}
+
+// Induce S-type suffixes from sorted suffixes, scanning right to left
+static void
+lz4_sa_induce_s(const unsigned char *s8, const uint32_t *s32, uint32_t *sa,
+                const uint32_t *t, uint32_t n, uint32_t *bkt, uint32_t k)
+{
+	lz4_sa_buckets(s8, s32, n, bkt, k, 1);
+
+	for (uint32_t i = n; i-- > 0; ) {
+		if (sa[i] != LZ4_SA_EMPTY && sa[i] > 0) {
+			const uint32_t j = sa[i] - 1;
+
+			if (lz4_sa_type(t, j)) {
+				sa[--bkt[lz4_sa_chr(s8, s32, n, j)]] = j;
+			}
+		}
+	}
+}
+
+// Construct suffix array of string of length n with characters in [0, k].
+//
+// This is SA-IS by Ge Nong, Sen Zhang and Wai Hong Chan, which sorts a
+// sample of the suffixes recursively and induces the order of the rest.
+//
+// bkt must have room for max(k + 1, n / 2 + 1) elements, and t for the
+// type bits of this and all recursion levels.
+//
+static void
+lz4_sa_is(const unsigned char *s8, const uint32_t *s32, uint32_t *sa,
+          uint32_t n, uint32_t k, uint32_t *bkt, uint32_t *t)
+{
+	assert(n >= 2);
+
+	// Classify suffixes as S-type or L-type
+	t[(n - 1) >> 5] = 0;
+	t[(n - 1) >> 5] |= UINT32_C(1) << ((n - 1) & 31);
+
+	for (uint32_t i = n - 1; i-- > 0; ) {
+		const uint32_t c = lz4_sa_chr(s8, s32, n, i);
+		const uint32_t c_next = lz4_sa_chr(s8, s32, n, i + 1);
+		const int type = c < c_next || (c == c_next && lz4_sa_type(t, i + 1));
+
+		if ((i & 31) == 31) {
+			t[i >> 5] = 0;
+		}
+
+		t[i >> 5] |= (uint32_t) type << (i & 31);
+	}
+
+	// Stage 1: Sort LMS substrings
+	lz4_sa_buckets(s8, s32, n, bkt, k, 1);
+
+	for (uint32_t i = 0; i < n; ++i) {
+		sa[i] = LZ4_SA_EMPTY;
+	}
+
+	for (uint32_t i = 1; i < n; ++i) {
+		if (lz4_sa_is_lms(t, i)) {
+			sa[--bkt[lz4_sa_chr(s8, s32, n, i)]] = i;
+		}
+	}
+
+	lz4_sa_induce_l(s8, s32, sa, t, n, bkt, k);
+	lz4_sa_induce_s(s8, s32, sa, t, n, bkt, k);
+
+	// Move sorted LMS substrings to the start of sa
+	uint32_t n1 = 0;
+
+	for (uint32_t i = 0; i < n; ++i) {
+		if (lz4_sa_is_lms(t, sa[i])) {
+			sa[n1++] = sa[i];
+		}
+	}
+
+	for (uint32_t i = n1; i < n; ++i) {
+		sa[i] = LZ4_SA_EMPTY;
+	}
+
+	// Name LMS substrings, storing names by position in second half
+	uint32_t name = 0;
+	uint32_t prev = LZ4_SA_EMPTY;
+
+	for (uint32_t i = 0; i < n1; ++i) {
+		const uint32_t pos = sa[i];
+		int diff = 0;
+
+		for (uint32_t d = 0; d < n; ++d) {
+			if (prev == LZ4_SA_EMPTY
+			 || lz4_sa_chr(s8, s32, n, pos + d) != lz4_sa_chr(s8, s32, n, prev + d)
+			 || lz4_sa_type(t, pos + d) != lz4_sa_type(t, prev + d)) {
+				diff = 1;
+				break;
+			}
+
+			if (d > 0 && (lz4_sa_is_lms(t, pos + d) || lz4_sa_is_lms(t, prev + d))) {
+				break;
+			}
+		}
+
+		if (diff) {
+			++name;
+			prev = pos;
+		}
+
+		sa[n1 + pos / 2] = name - 1;
+	}
+
+	for (uint32_t i = n, j = n; i-- > n1; ) {
+		if (sa[i] != LZ4_SA_EMPTY) {
+			sa[--j] = sa[i];
+		}
+	}
+
+	// Stage 2: Sort reduced string, recursing if names are not unique
+	uint32_t *const sa1 = sa;
+	uint32_t *const s1 = sa + n - n1;
+
+	if (name < n1) {
+		lz4_sa_is(NULL, s1, sa1, n1, name - 1, bkt, t + (n >> 5) + 1);
+	}
+	else {
+		for (uint32_t i = 0; i < n1; ++i) {
+			sa1[s1[i]] = i;
+		}
+	}
+
+	// Stage 3: Induce suffix array from sorted LMS suffixes
+	for (uint32_t i = 1, j = 0; i < n; ++i) {
+		if (lz4_sa_is_lms(t, i)) {
+			s1[j++] = i;
+		}
+	}
+
+	for (uint32_t i = 0; i < n1; ++i) {
+		sa1[i] = s1[sa1[i]];
+	}
+
+	for (uint32_t i = n1; i < n; ++i) {
+		sa[i] = LZ4_SA_EMPTY;
+	}
+
+	lz4_sa_buckets(s8, s32, n, bkt, k, 1);
+
+	for (uint32_t i = n1; i-- > 0; ) {
+		const uint32_t j = sa[i];
+		sa[i] = LZ4_SA_EMPTY;
+		sa[--bkt[lz4_sa_chr(s8, s32, n, j)]] = j;
+	}
+
+	lz4_sa_induce_l(s8, s32, sa, t, n, bkt, k);
+	lz4_sa_induce_s(s8, s32, sa, t, n, bkt, k);
+}
+
+// Set of ranks of positions in the window.
+//
+// This is a tree of bitmaps with 32 bits per word, where a bit is set if
+// the corresponding word on the level below is non-zero. It allows finding
+// the closest element in either direction in a few steps.
+//
+struct lz4_sa_set {
+	uint32_t *level[LZ4_SA_SET_MAX_DEPTH];
+	int depth;
+};
+
+// Get number of words used by a set with n elements
+static size_t
+lz4_sa_set_words(size_t n)
+{
+	size_t words = 0;
+
+	do {
+		n = (n + 31) / 32;
+		words += n;
+	} while (n > 1);
+
+	return words;
+}
+
+static void
+lz4_sa_set_init(struct lz4_sa_set *set, uint32_t *words, size_t n)
+{
+	set->depth = 0;
+
+	do {
+		n = (n + 31) / 32;
+
+		set->level[set->depth++] = words;
+
+		for (size_t i = 0; i < n; ++i) {
+			*words++ = 0;
+		}
+	} while (n > 1);
+}
+
+static void
+lz4_sa_set_insert(struct lz4_sa_set *set, uint32_t x)
+{
+	for (int k = 0; k < set->depth; ++k, x >>= 5) {
+		const uint32_t old = set->level[k][x >> 5];
+
+		set->level[k][x >> 5] = old | (UINT32_C(1) << (x & 31));
+
+		if (old != 0) {
+			break;
+		}
+	}
+}
+
+static void
+lz4_sa_set_erase(struct lz4_sa_set *set, uint32_t x)
+{
+	for (int k = 0; k < set->depth; ++k, x >>= 5) {
+		set->level[k][x >> 5] &= ~(UINT32_C(1) << (x & 31));
+
+		if (set->level[k][x >> 5] != 0) {
+			break;
+		}
+	}
+}
+
+// Find largest element less than x
+static uint32_t
+lz4_sa_set_pred(const struct lz4_sa_set *set, uint32_t x)
+{
+	for (int k = 0; k < set->depth; ++k, x >>= 5) {
+		const uint32_t m = set->level[k][x >> 5] & ((UINT32_C(1) << (x & 31)) - 1);
+
+		if (m != 0) {
+			x = (x & ~UINT32_C(31)) | (uint32_t) lz4_log2(m);
+
+			// Descend taking the largest element on each level
+			while (k-- > 0) {
+				x = (x << 5) | (uint32_t) lz4_log2(set->level[k][x]);
+			}
+
+			return x;
+		}
+	}
+
+	return LZ4_SA_EMPTY;
+}
+
+// Find smallest element greater than x
+static uint32_t
+lz4_sa_set_succ(const struct lz4_sa_set *set, uint32_t x)
+{
+	for (int k = 0; k < set->depth; ++k, x >>= 5) {
+		const uint32_t m = set->level[k][x >> 5] & ~((UINT32_C(2) << (x & 31)) - 1);
+
+		if (m != 0) {
+			x = (x & ~UINT32_C(31)) | (uint32_t) lz4_log2(m & (0 - m));
+
+			// Descend taking the smallest element on each level
+			while (k-- > 0) {
+				const uint32_t w = set->level[k][x];
+				x = (x << 5) | (uint32_t) lz4_log2(w & (0 - w));
+			}
+
+			return x;
+		}
+	}
+
+	return LZ4_SA_EMPTY;
+}
+
+// Get minimum of lcp[lo..hi) from segment tree over n values
+static uint32_t
+lz4_sa_lcp_min(const uint32_t *seg, size_t n, size_t lo, size_t hi)
+{
+	uint32_t res = UINT32_MAX;
+
+	// Adjacent suffixes are common, and need only the leaf
+	if (hi - lo == 1) {
+		return seg[n + lo];
+	}
+
+	for (lo += n, hi += n; lo < hi; lo >>= 1, hi >>= 1) {
+		if (lo & 1) {
+			res = seg[lo] < res ? seg[lo] : res;
+			++lo;
+		}
+		if (hi & 1) {
+			--hi;
+			res = seg[hi] < res ? seg[hi] : res;
+		}
+	}
+
+	return res;
+}
+
+// Get size of the area used for cost, mpos, mlen and the segment tree,
+// which is also used for temporary data while constructing the suffix
+// array.
+//
+static size_t
+lz4_saparse_front_words(size_t src_size)
+{
+	const size_t dp_words = 5 * src_size + 3;
+	const size_t bkt_words = src_size / 2 + 2 > 257 ? src_size / 2 + 2 : 257;
+	const size_t type_words = 2 * ((src_size + 1) / 32 + 1) + 2 * 32;
+
+	return dp_words > bkt_words + type_words ? dp_words : bkt_words + type_words;
+}
+
+static size_t
+lz4_saparse_workmem_size(size_t src_size, int hash_bits)
+{
+	const size_t sa_size = (lz4_saparse_front_words(src_size) + 2 * src_size + 1
+	                     + lz4_sa_set_words(src_size)) * sizeof(uint32_t);
+	const size_t bt_size = lz4_btparse_workmem_size(src_size, hash_bits);
+
+	return sa_size > bt_size ? sa_size : bt_size;
+}
+
+// Forwards dynamic programming parse using a suffix array, checking the
+// longest match at each position.
+//
+// We build the suffix array of the input with SA-IS, and the LCP array
+// with the algorithm by Kasai et al. For each position, the longest match
+// within the window is then with the closest suffix in either direction
+// in suffix array order, among the positions in the window. We keep
+// the ranks of the positions in the window in a set that allows finding
+// these neighbours quickly, and get the length of the match as the
+// minimum of the LCP array between them, using a segment tree.
+//
+// This finds the same match lengths as the binary tree search with no
+// limit on depth, but in O(n log n) time regardless of the input, where
+// the binary trees degenerate on repetitive data.
+//
+// The match lengths are then used with the same cost model as btparse.
+//
+// Building the suffix array is several times slower than the binary tree
+// search on most data, and uses 7 words of workmem per position instead
+// of about 5 per position of a chunk. So we first run btparse with no
+// limit on depth, and only build the suffix array if it does more than
+// LZ4_SAPARSE_MAX_TREE_WORK work per position. Of params, only hash_bits
+// and window_size are used.
+//
+static unsigned long
+lz4_pack_saparse(const void *src, void *dst, unsigned long src_size,
+                 unsigned long dict_size, void *workmem,
+                 const struct lz4_params *params)
+{
+	const unsigned char *const in = (const unsigned char *) src;
+	const unsigned long last_match_pos = src_size > 12 ? src_size - 12 : 0;
+	const unsigned long window_size = params->window_size;
+
+	// Check for empty input
+	if (src_size == dict_size) {
+		unsigned char *out = (unsigned char *) dst;
+		*out++ = 0;
+		return 1;
+	}
+
+	// Check for input without room for match
+	if (src_size - dict_size < 13) {
+		unsigned char *out = (unsigned char *) dst;
+		*out++ = (src_size - dict_size) << 4;
+		for (unsigned long i = dict_size; i < src_size; ++i) {
+			*out++ = in[i];
+		}
+		return 1 + src_size - dict_size;
+	}
+
+	// Try the binary trees first
+	{
+		struct lz4_params bt_params = *params;
+
+		bt_params.max_depth = ULONG_MAX;
+		bt_params.accept_len = ULONG_MAX;
+
+		const unsigned long packed_size = lz4_pack_btparse(src, dst, src_size, dict_size, workmem,
+		                                                   &bt_params, NULL, LZ4_SAPARSE_MAX_TREE_WORK);
+
+		if (packed_size != LZ4_ERROR) {
+			return packed_size;
+		}
+	}
+
+	const size_t n = src_size;
+
+	uint32_t *const cost = (uint32_t *) workmem;
+	uint32_t *const mpos = cost + n + 1;
+	uint32_t *const mlen = mpos + n + 1;
+	uint32_t *const seg = mlen + n + 1;
+	uint32_t *const sa = cost + lz4_saparse_front_words(n);
+	uint32_t *const rank = sa + n + 1;
+	uint32_t *const set_words = rank + n;
+
+	// Phase 1: Build suffix array, rank and LCP array
+	//
+	// The suffix array includes the virtual sentinel at the end, which is
+	// the smallest suffix and thus in sa[0].
+	//
+	{
+		uint32_t *const bkt = cost;
+		uint32_t *const t = bkt + (n / 2 + 2 > 257 ? n / 2 + 2 : 257);
+
+		lz4_sa_is(in, NULL, sa, (uint32_t) n + 1, 256, bkt, t);
+	}
+
+	assert(sa[0] == n);
+
+	uint32_t *const suffix = sa + 1;
+
+	for (size_t i = 0; i < n; ++i) {
+		rank[suffix[i]] = (uint32_t) i;
+	}
+
+	// Compute LCP array into the leaves of the segment tree
+	{
+		unsigned long h = 0;
+
+		for (size_t i = 0; i < n; ++i) {
+			const uint32_t r = rank[i];
+
+			if (r == 0) {
+				h = 0;
+				seg[n] = 0;
+				continue;
+			}
+
+			const size_t j = suffix[r - 1];
+
+			h = lz4_match_len(&in[i], &in[j], h, (unsigned long) (n - (i > j ? i : j)));
+
+			seg[n + r] = (uint32_t) h;
+
+			if (h > 0) {
+				--h;
+			}
+		}
+	}
+
+	for (size_t i = n - 1; i > 0; --i) {
+		seg[i] = seg[2 * i] < seg[2 * i + 1] ? seg[2 * i] : seg[2 * i + 1];
+	}
+
+	struct lz4_sa_set window;
+
+	lz4_sa_set_init(&window, set_words, n);
+
+	// Initialize to all literals with infinite cost
+	for (unsigned long i = 0; i <= src_size; ++i) {
+		cost[i] = UINT32_MAX;
+		mlen[i] = 1;
+		mpos[i] = 0;
+	}
+
+	cost[dict_size] = 0;
+
+	// Phase 2: Find lowest cost path arriving at each position
+	for (unsigned long cur = 0; cur <= last_match_pos; ++cur) {
+		// Remove position that is no longer in the window
+		if (cur > window_size) {
+			lz4_sa_set_erase(&window, rank[cur - window_size - 1]);
+		}
+
+		// Dictionary positions are only inserted into the window
+		if (cur < dict_size) {
+			lz4_sa_set_insert(&window, rank[cur]);
+			continue;
+		}
+
+		// Check literal
+		//
+		// For literals, we store the number of literals up to the
+		// current position in mpos. This is used to update the cost
+		// from the current position with the additional cost of
+		// encoding the length of this run of literals in the next
+		// match.
+		//
+		if (mlen[cur] == 1) {
+			unsigned long literals_cost = 1 + lz4_literal_cost(mpos[cur] + 1) - lz4_literal_cost(mpos[cur]);
+
+			if (cost[cur + 1] > cost[cur] + literals_cost) {
+				cost[cur + 1] = cost[cur] + literals_cost;
+				mlen[cur + 1] = 1;
+				mpos[cur + 1] = mpos[cur] + 1;
+			}
+		}
+		else {
+			if (cost[cur + 1] > cost[cur] + 1) {
+				cost[cur + 1] = cost[cur] + 1;
+				mlen[cur + 1] = 1;
+				mpos[cur + 1] = 1;
+			}
+		}
+
+		const uint32_t r = rank[cur];
+
+		unsigned long max_len = 3;
+		unsigned long max_len_pos = NO_MATCH_POS;
+
+		// Check closest suffix in the window before and after in
+		// suffix array order
+		const uint32_t r_lt = lz4_sa_set_pred(&window, r);
+		const uint32_t r_gt = lz4_sa_set_succ(&window, r);
+
+		if (r_lt != LZ4_SA_EMPTY) {
+			unsigned long len = lz4_sa_lcp_min(seg, n, (size_t) r_lt + 1, (size_t) r + 1);
+
+			if (len > max_len) {
+				max_len = len;
+				max_len_pos = suffix[r_lt];
+			}
+		}
+
+		if (r_gt != LZ4_SA_EMPTY) {
+			unsigned long len = lz4_sa_lcp_min(seg, n, (size_t) r + 1, (size_t) r_gt + 1);
+
+			if (len > max_len || (len == max_len && suffix[r_gt] > max_len_pos)) {
+				max_len = len;
+				max_len_pos = suffix[r_gt];
+			}
+		}
+
+		lz4_sa_set_insert(&window, r);
+
+		if (max_len > src_size - cur - 5) {
+			max_len = src_size - cur - 5;
+		}
+
+		// Update costs for longest match found
+		//
+		// See lz4_pack_btparse for why we only have to check the last
+		// 255 possible match lengths.
+		//
+		if (max_len_pos != NO_MATCH_POS && max_len >= 4) {
+			assert(max_len_pos < cur && cur - max_len_pos <= window_size);
+
+			unsigned long min_len = max_len > (254 + 4) ? max_len - 254 : 4;
+
+			for (unsigned long i = min_len; i <= max_len; ++i) {
+				unsigned long match_cost = lz4_match_cost(i);
+
+				assert(match_cost < UINT32_MAX - cost[cur]);
+
+				unsigned long cost_there = cost[cur] + match_cost;
+
+				// If the choice is between a literal and a
+				// match with the same cost, choose the match.
+				// This is because the match is able to encode
+				// any literals preceding it.
+				if (cost_there < cost[cur + i]
+				 || (mlen[cur + i] == 1 && cost_there == cost[cur + i])) {
+					cost[cur + i] = cost_there;
+					mpos[cur + i] = max_len_pos;
+					mlen[cur + i] = i;
+				}
+			}
+		}
+	}
+
+	for (unsigned long cur = last_match_pos + 1; cur < src_size; ++cur) {
+		// Check literal
+		if (mlen[cur] == 1) {
+			unsigned long literals_cost = 1 + lz4_literal_cost(mpos[cur] + 1) - lz4_literal_cost(mpos[cur]);
+
+			if (cost[cur + 1] > cost[cur] + literals_cost) {
+				cost[cur + 1] = cost[cur] + literals_cost;
+				mlen[cur + 1] = 1;
+				mpos[cur + 1] = mpos[cur] + 1;
+			}
+		}
+		else {
+			if (cost[cur + 1] > cost[cur] + 1) {
+				cost[cur + 1] = cost[cur] + 1;
+				mlen[cur + 1] = 1;
+				mpos[cur + 1] = 1;
+			}
+		}
+	}
+
+	// Phase 3: Follow lowest cost path backwards gathering tokens
+	unsigned long next_token = src_size;
+
+	for (unsigned long cur = src_size; cur > dict_size; cur -= mlen[cur], --next_token) {
+		mlen[next_token] = mlen[cur];
+		mpos[next_token] = mpos[cur];
+	}
+
+	// Phase 4: Output tokens
+	unsigned char *out = (unsigned char *) dst;
+
+	unsigned long cur = dict_size;
+	unsigned long next_lit = dict_size;
+
+	for (unsigned long i = next_token + 1; i <= src_size; ++i) {
+		if (mlen[i] == 1) {
+			++cur;
+			continue;
+		}
+
+		// Output literals up to match and the match
+		out = lz4_write_sequence(out, &in[next_lit], cur - next_lit,
+		                         cur - mpos[i], mlen[i]);
+
+		cur += mlen[i];
+		next_lit = cur;
+	}
+
+	// Output last literals
+	out = lz4_write_sequence(out, &in[next_lit], src_size - next_lit, 0, 0);
+
+	// Return compressed size
+	return (unsigned long) (out - (unsigned char *) dst);
+}
+
+#endif /* LZ4_SAPARSE_H_INCLUDED */
@@ -28,35 +28,58 @@
 #ifndef LZ4_SSPARSE_H_INCLUDED
 #define LZ4_SSPARSE_H_INCLUDED
 
+// Get number of hash bits to use for input of src_size bytes.
+//
+// Small inputs use a lookup sized to the input, while large inputs use
+// the space of mpos and mlen, which is free while building hash chains,
+// for up to log2 of src_size bits. Both are limited to hash_bits.
+//
+static int
+lz4_ssparse_bits(size_t src_size, int hash_bits)
+{
+	if (2 * src_size < ((size_t) 1 << LZ4_HASH_BITS)) {
+		return lz4_lookup_bits(src_size, hash_bits);
+	}
+
+	const int bits = lz4_log2((unsigned long) src_size);
+
+	return bits < hash_bits ? bits : hash_bits;
+}
+
 static size_t
-lz4_ssparse_workmem_size(size_t src_size)
+lz4_ssparse_workmem_size(size_t src_size, int hash_bits)
 {
-	return (LOOKUP_SIZE < 2 * src_size ? 3 * src_size : src_size + LOOKUP_SIZE)
+	const size_t lookup_size = (size_t) 1 << lz4_ssparse_bits(src_size, hash_bits);
+
+	return (lookup_size < 2 * src_size ? 3 * src_size : src_size + lookup_size)
 	     * sizeof(uint32_t);
 }
 
 static unsigned long
-lz4_pack_ssparse(const void *src, void *dst, unsigned long src_size, void *workmem,
-                 const unsigned long max_depth, const unsigned long accept_len)
+lz4_pack_ssparse(const void *src, void *dst, unsigned long src_size,
+                 unsigned long dict_size, void *workmem,
+                 const struct lz4_params *params)
 {
 	const unsigned char *const in = (const unsigned char *) src;
 	const unsigned long last_match_pos = src_size > 12 ? src_size - 12 : 0;
+	const unsigned long max_depth = params->max_depth;
+	const unsigned long accept_len = params->accept_len;
 
 	// Check for empty input
-	if (src_size == 0) {
+	if (src_size == dict_size) {
 		unsigned char *out = (unsigned char *) dst;
 		*out++ = 0;
 		return 1;
 	}
 
 	// Check for input without room for match
-	if (src_size < 13) {
+	if (src_size - dict_size < 13) {
 		unsigned char *out = (unsigned char *) dst;
-		*out++ = src_size << 4;
-		for (unsigned long i = 0; i < src_size; ++i) {
+		*out++ = (src_size - dict_size) << 4;
+		for (unsigned long i = dict_size; i < src_size; ++i) {
 			*out++ = in[i];
 		}
-		return 1 + src_size;
+		return 1 + src_size - dict_size;
 	}
 
 	// With a bit of careful ordering we can fit in 3 * src_size words.
@@ -76,7 +99,7 @@ lz4_pack_ssparse(const void *src, void *dst, unsigned long src_size, void *workm
 	uint32_t *const lookup = mpos;
 
 	// Phase 1: Build hash chains
-	const int bits = 2 * src_size < LOOKUP_SIZE ? LZ4_HASH_BITS : lz4_log2(src_size);
+	const int bits = lz4_ssparse_bits(src_size, params->hash_bits);
 
 	// Initialize lookup
 	for (unsigned long i = 0; i < (1UL << bits); ++i) {
@@ -100,8 +123,17 @@ lz4_pack_ssparse(const void *src, void *dst, unsigned long src_size, void *workm
 	}
 	cost[src_size] = 0;
 
+	// The first position has no matches unless there is a dictionary
+	const unsigned long first_match_pos = dict_size > 0 ? dict_size : 1;
+
+	// Longest match found at the closest position after cur that had
+	// one, as position, offset and length
+	unsigned long run_pos = NO_MATCH_POS;
+	unsigned long run_offs = 0;
+	unsigned long run_len = 0;
+
 	// Phase 2: Find lowest cost path from each position to end
-	for (unsigned long cur = last_match_pos; cur > 0; --cur) {
+	for (unsigned long cur = last_match_pos; cur >= first_match_pos; --cur) {
 		// Since we updated prev to the end in the first phase, we
 		// do not need to hash, but can simply look up the previous
 		// position directly.
@@ -129,25 +161,38 @@ lz4_pack_ssparse(const void *src, void *dst, unsigned long src_size, void *workm
 		}
 
 		unsigned long max_len = 3;
+		unsigned long max_len_pos = NO_MATCH_POS;
 
 		const unsigned long len_limit = src_size - cur - 5;
 		unsigned long num_chain = max_depth;
 
 		// Go through the chain of prev matches
 		for (; pos != NO_MATCH_POS && num_chain--; pos = prev[pos]) {
-			if (cur - pos > 65535) {
+			if (cur - pos > params->window_size) {
 				break;
 			}
 
 			unsigned long len = 0;
 
-			// If next byte matches, so this has a chance to be a longer match
-			if (max_len < len_limit && in[pos + max_len] == in[cur + max_len]) {
-				// Find match len
-				while (len < len_limit && in[pos + len] == in[cur + len]) {
-					++len;
+			if (cur - pos == run_offs) {
+				// The longest match at run_pos has the same
+				// offset, so if the bytes up to run_pos match,
+				// this match continues into it. This saves
+				// comparing the whole match again at every
+				// position of a long run.
+				const unsigned long gap = run_pos - cur;
+
+				len = lz4_match_len(&in[pos], &in[cur], 0, gap);
+
+				if (len == gap) {
+					len += run_len;
 				}
 			}
+			else if (max_len < len_limit && in[pos + max_len] == in[cur + max_len]) {
+				// If next byte matches, so this has a chance to
+				// be a longer match, find match len
+				len = lz4_match_len(&in[pos], &in[cur], len, len_limit);
+			}
 
 			// Extend current match if possible
 			//
@@ -161,7 +206,21 @@ lz4_pack_ssparse(const void *src, void *dst, unsigned long src_size, void *workm
 				unsigned long min_cost_len = 3;
 
 				// Find lowest cost match length
-				for (unsigned long i = max_len + 1; i <= len; ++i) {
+				//
+				// Like in btparse, we only check the last 255
+				// possible match lengths, since decreasing the
+				// length further saves at most one byte on the
+				// match length encoding, which the following
+				// sequence can make up for. If the match is also
+				// accept_len or longer, we take all of it.
+				//
+				// Without this, long matches in repetitive data
+				// make the parse quadratic in the match length.
+				//
+				const unsigned long min_len = len <= max_len + 255 ? max_len + 1
+				                            : len >= accept_len ? len : len - 254;
+
+				for (unsigned long i = min_len; i <= len; ++i) {
 					unsigned long match_cost = lz4_match_cost(i);
 					assert(match_cost < UINT32_MAX - cost[cur + i]);
 					unsigned long cost_here = match_cost + cost[cur + i];
@@ -173,6 +232,7 @@ lz4_pack_ssparse(const void *src, void *dst, unsigned long src_size, void *workm
 				}
 
 				max_len = len;
+				max_len_pos = pos;
 
 				// Update cost if cheaper
 				//
@@ -193,15 +253,23 @@ lz4_pack_ssparse(const void *src, void *dst, unsigned long src_size, void *workm
 				break;
 			}
 		}
+
+		if (max_len_pos != NO_MATCH_POS) {
+			run_pos = cur;
+			run_offs = cur - max_len_pos;
+			run_len = max_len;
+		}
 	}
 
-	mpos[0] = 0;
-	mlen[0] = 1;
+	if (dict_size == 0) {
+		mpos[0] = 0;
+		mlen[0] = 1;
+	}
 
 	unsigned char *out = (unsigned char *) dst;
 
 	// Phase 3: Output compressed data, following lowest cost path
-	for (unsigned long i = 0; i < src_size; i += mlen[i]) {
+	for (unsigned long i = dict_size; i < src_size; i += mlen[i]) {
 		unsigned long next_lit = i;
 		unsigned long nlit = 0;
 
@@ -0,0 +1,234 @@
+//
+// blz4 - Example of LZ4 compression with BriefLZ algorithms
+//
+// xxHash32 checksum used by the LZ4 frame format
+//
+// Copyright (c) 2026 Joergen Ibsen
+//
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//   1. The origin of this software must not be misrepresented; you must
+//      not claim that you wrote the original software. If you use this
+//      software in a product, an acknowledgment in the product
+//      documentation would be appreciated but is not required.
+//
+//   2. Altered source versions must be plainly marked as such, and must
+//      not be misrepresented as being the original software.
+//
+//   3. This notice may not be removed or altered from any source
+//      distribution.
+//
+
+#include "lz4.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM64))
+#  define LZ4_LITTLE_ENDIAN
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define LZ4_LITTLE_ENDIAN
+#endif
+
+#define LZ4_XXH_PRIME32_1 0x9E3779B1U
+#define LZ4_XXH_PRIME32_2 0x85EBCA77U
+#define LZ4_XXH_PRIME32_3 0xC2B2AE3DU
+#define LZ4_XXH_PRIME32_4 0x27D4EB2FU
+#define LZ4_XXH_PRIME32_5 0x165667B1U
+
+static uint32_t
+lz4_xxh32_read32(const unsigned char *p)
+{
+#if defined(LZ4_LITTLE_ENDIAN)
+	uint32_t val;
+
+	memcpy(&val, p, sizeof(val));
+
+	return val;
+#else
+	return (uint32_t) p[0]
+	     | ((uint32_t) p[1] << 8)
+	     | ((uint32_t) p[2] << 16)
+	     | ((uint32_t) p[3] << 24);
+#endif
+}
+
+static uint32_t
+lz4_xxh32_rotl(uint32_t x, int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+static uint32_t
+lz4_xxh32_round(uint32_t acc, uint32_t input)
+{
+	acc += input * LZ4_XXH_PRIME32_2;
+	acc = lz4_xxh32_rotl(acc, 13);
+	acc *= LZ4_XXH_PRIME32_1;
+#if defined(__GNUC__) && !defined(__INTEL_COMPILER)
+	// Keep GCC from vectorizing the lanes, see lz4_xxh32_stripes
+	__asm__("" : "+r" (acc));
+#endif
+	return acc;
+}
+
+// Process 16-byte stripes from p, returning the number of bytes used.
+//
+// The four lanes are independent, so we keep them in local variables,
+// which lets the compiler keep them in registers and overlap the latency
+// of the multiplications. This is faster than using SIMD, since SSE2 and
+// AVX2 lack a 32-bit rotate and SSE2 a 32-bit multiply. GCC will
+// vectorize the lanes anyway, with the multiplications turned into
+// shifts and adds, which runs at less than half the speed.
+//
+static size_t
+lz4_xxh32_stripes(unsigned long acc[4], const unsigned char *p, size_t size)
+{
+	uint32_t v1 = (uint32_t) acc[0];
+	uint32_t v2 = (uint32_t) acc[1];
+	uint32_t v3 = (uint32_t) acc[2];
+	uint32_t v4 = (uint32_t) acc[3];
+	size_t i;
+
+	for (i = 0; i + 16 <= size; i += 16) {
+		v1 = lz4_xxh32_round(v1, lz4_xxh32_read32(p + i));
+		v2 = lz4_xxh32_round(v2, lz4_xxh32_read32(p + i + 4));
+		v3 = lz4_xxh32_round(v3, lz4_xxh32_read32(p + i + 8));
+		v4 = lz4_xxh32_round(v4, lz4_xxh32_read32(p + i + 12));
+	}
+
+	acc[0] = v1;
+	acc[1] = v2;
+	acc[2] = v3;
+	acc[3] = v4;
+
+	return i;
+}
+
+// Mix remaining bytes into h and compute final hash value.
+static uint32_t
+lz4_xxh32_finalize(uint32_t h, const unsigned char *p, size_t size)
+{
+	for (; size >= 4; p += 4, size -= 4) {
+		h += lz4_xxh32_read32(p) * LZ4_XXH_PRIME32_3;
+		h = lz4_xxh32_rotl(h, 17) * LZ4_XXH_PRIME32_4;
+	}
+
+	for (; size > 0; ++p, --size) {
+		h += *p * LZ4_XXH_PRIME32_5;
+		h = lz4_xxh32_rotl(h, 11) * LZ4_XXH_PRIME32_1;
+	}
+
+	h ^= h >> 15;
+	h *= LZ4_XXH_PRIME32_2;
+	h ^= h >> 13;
+	h *= LZ4_XXH_PRIME32_3;
+	h ^= h >> 16;
+
+	return h;
+}
+
+static uint32_t
+lz4_xxh32_merge(const unsigned long acc[4])
+{
+	return lz4_xxh32_rotl((uint32_t) acc[0], 1)
+	     + lz4_xxh32_rotl((uint32_t) acc[1], 7)
+	     + lz4_xxh32_rotl((uint32_t) acc[2], 12)
+	     + lz4_xxh32_rotl((uint32_t) acc[3], 18);
+}
+
+void
+lz4_xxh32_init(struct lz4_xxh32_state *state, unsigned long seed)
+{
+	const uint32_t s = (uint32_t) seed;
+
+	state->acc[0] = (uint32_t) (s + LZ4_XXH_PRIME32_1 + LZ4_XXH_PRIME32_2);
+	state->acc[1] = (uint32_t) (s + LZ4_XXH_PRIME32_2);
+	state->acc[2] = s;
+	state->acc[3] = (uint32_t) (s - LZ4_XXH_PRIME32_1);
+	state->seed = s;
+	state->total_len = 0;
+	state->buf_size = 0;
+}
+
+void
+lz4_xxh32_update(struct lz4_xxh32_state *state, const void *data, size_t size)
+{
+	const unsigned char *p = (const unsigned char *) data;
+
+	state->total_len += size;
+
+	// Fill up buffered stripe
+	if (state->buf_size > 0) {
+		size_t fill = 16 - state->buf_size;
+
+		if (fill > size) {
+			fill = size;
+		}
+
+		memcpy(state->buf + state->buf_size, p, fill);
+		state->buf_size += fill;
+		p += fill;
+		size -= fill;
+
+		if (state->buf_size < 16) {
+			return;
+		}
+
+		lz4_xxh32_stripes(state->acc, state->buf, 16);
+		state->buf_size = 0;
+	}
+
+	const size_t used = lz4_xxh32_stripes(state->acc, p, size);
+
+	// Buffer remaining bytes
+	memcpy(state->buf, p + used, size - used);
+	state->buf_size = size - used;
+}
+
+unsigned long
+lz4_xxh32_digest(const struct lz4_xxh32_state *state)
+{
+	uint32_t h = state->total_len >= 16 ? lz4_xxh32_merge(state->acc)
+	           : (uint32_t) (state->seed + LZ4_XXH_PRIME32_5);
+
+	h += (uint32_t) state->total_len;
+
+	return lz4_xxh32_finalize(h, state->buf, state->buf_size);
+}
+
+unsigned long
+lz4_xxh32(const void *data, size_t size, unsigned long seed)
+{
+	const unsigned char *p = (const unsigned char *) data;
+	const uint32_t s = (uint32_t) seed;
+	uint32_t h;
+	size_t used = 0;
+
+	if (size >= 16) {
+		unsigned long acc[4] = {
+			(uint32_t) (s + LZ4_XXH_PRIME32_1 + LZ4_XXH_PRIME32_2),
+			(uint32_t) (s + LZ4_XXH_PRIME32_2),
+			s,
+			(uint32_t) (s - LZ4_XXH_PRIME32_1)
+		};
+
+		used = lz4_xxh32_stripes(acc, p, size);
+
+		h = lz4_xxh32_merge(acc);
+	}
+	else {
+		h = s + LZ4_XXH_PRIME32_5;
+	}
+
+	h += (uint32_t) size;
+
+	return lz4_xxh32_finalize(h, p + used, size - used);
+}
@@ -0,0 +1,621 @@
+/*
+ * lz4bench - Benchmark of compression levels on generated data
+ *
+ * Copyright (c) 2026 Joergen Ibsen
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must
+ *      not claim that you wrote the original software. If you use this
+ *      software in a product, an acknowledgment in the product
+ *      documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must
+ *      not be misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *      distribution.
+ */
+
+#ifdef _MSC_VER
+#  define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lz4.h"
+#include "parg.h"
+
+/*
+ * Highest level benchmarked, --optimal.
+ */
+#define MAX_LEVEL 10
+
+/*
+ * Number of times each measurement is repeated, the fastest is used.
+ */
+#define NUM_RUNS 3
+
+/*
+ * Minimum time in clocks of each measurement.
+ */
+#define MIN_CLOCKS (CLOCKS_PER_SEC / 10)
+
+typedef unsigned char byte;
+
+/*
+ * State of the pseudo-random generator, xorshift32 so the data is the
+ * same on all platforms.
+ */
+struct rng {
+	unsigned long x;
+};
+
+static unsigned long
+rng_next(struct rng *rng)
+{
+	unsigned long x = rng->x;
+
+	x ^= (x << 13) & 0xFFFFFFFFUL;
+	x ^= x >> 17;
+	x ^= (x << 5) & 0xFFFFFFFFUL;
+
+	return rng->x = x;
+}
+
+/*
+ * Get random number from 0 to `n - 1`.
+ */
+static unsigned long
+rng_below(struct rng *rng, unsigned long n)
+{
+	return rng_next(rng) % n;
+}
+
+/*
+ * Get random number from 0 to `n - 1`, where small numbers are more
+ * likely, roughly like word frequencies in text.
+ */
+static unsigned long
+rng_skewed(struct rng *rng, unsigned long n)
+{
+	const unsigned long r = rng_below(rng, n);
+
+	return rng_below(rng, r + 1);
+}
+
+/*
+ * Append `len` bytes of `s` to `data` at `*pos`, stopping at `size`.
+ */
+static void
+put_bytes(byte *data, unsigned long size, unsigned long *pos,
+          const char *s, size_t len)
+{
+	if (len > size - *pos) {
+		len = size - *pos;
+	}
+
+	memcpy(data + *pos, s, len);
+	*pos += len;
+}
+
+static const char *const words[] = {
+	"the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as",
+	"was", "with", "be", "by", "on", "not", "he", "this", "are", "or",
+	"his", "from", "at", "which", "but", "have", "an", "had", "they",
+	"you", "were", "their", "one", "all", "we", "can", "her", "has",
+	"there", "been", "if", "more", "when", "will", "would", "who", "so",
+	"no", "time", "people", "water", "house", "letter", "morning",
+	"evening", "question", "answer", "window", "river", "mountain",
+	"compression", "literal", "offset", "sequence", "history",
+	"dictionary", "between", "through", "without", "something",
+	"everything", "remember", "understand", "government", "particular"
+};
+
+#define NUM_WORDS (sizeof(words) / sizeof(words[0]))
+
+/*
+ * Sentences of words, with punctuation and line breaks.
+ */
+static void
+generate_text(byte *data, unsigned long size, struct rng *rng)
+{
+	unsigned long pos = 0;
+	unsigned long line = 0;
+	int capital = 1;
+
+	while (pos < size) {
+		const char *word = words[rng_skewed(rng, NUM_WORDS)];
+		size_t len = strlen(word);
+		char buf[32];
+
+		memcpy(buf, word, len);
+
+		if (capital) {
+			buf[0] = (char) (buf[0] - 'a' + 'A');
+			capital = 0;
+		}
+
+		switch (rng_below(rng, 16)) {
+		case 0:
+			buf[len++] = ',';
+			break;
+		case 1:
+			buf[len++] = '.';
+			capital = 1;
+			break;
+		default:
+			break;
+		}
+
+		/* Break lines at about 72 characters */
+		line += len + 1;
+		buf[len++] = line > 72 ? '\n' : ' ';
+
+		if (line > 72) {
+			line = 0;
+		}
+
+		put_bytes(data, size, &pos, buf, len);
+	}
+}
+
+/*
+ * Lines of a server log, with increasing timestamps and varying fields.
+ */
+static void
+generate_log(byte *data, unsigned long size, struct rng *rng)
+{
+	static const char *const levels[] = { "INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR" };
+	static const char *const paths[] = {
+		"/", "/index.html", "/api/v1/items", "/api/v1/users", "/static/app.js",
+		"/static/style.css", "/login", "/api/v1/search"
+	};
+	static const int statuses[] = { 200, 200, 200, 200, 304, 404, 500 };
+	unsigned long pos = 0;
+	unsigned long ms = 0;
+	unsigned long request = 100000;
+
+	while (pos < size) {
+		char line[160];
+		int len;
+
+		ms += rng_below(rng, 250);
+		++request;
+
+		len = sprintf(line, "2026-01-%02lu %02lu:%02lu:%02lu.%03lu %-5s [worker-%lu] "
+		              "request %lu from 10.0.%lu.%lu GET %s status=%d took %lu ms\n",
+		              1 + ms / 86400000UL % 28, ms / 3600000UL % 24,
+		              ms / 60000UL % 60, ms / 1000UL % 60, ms % 1000,
+		              levels[rng_below(rng, sizeof(levels) / sizeof(levels[0]))],
+		              rng_below(rng, 8), request,
+		              rng_below(rng, 4), rng_below(rng, 256),
+		              paths[rng_skewed(rng, sizeof(paths) / sizeof(paths[0]))],
+		              statuses[rng_below(rng, sizeof(statuses) / sizeof(statuses[0]))],
+		              rng_skewed(rng, 2000));
+
+		put_bytes(data, size, &pos, line, (size_t) len);
+	}
+}
+
+/*
+ * Array of little-endian records with counters, small values, flags and
+ * some noise, like tables in executables and databases.
+ */
+static void
+generate_binary(byte *data, unsigned long size, struct rng *rng)
+{
+	unsigned long pos = 0;
+	unsigned long id = 0;
+	unsigned long addr = 0x00401000UL;
+
+	while (pos < size) {
+		byte rec[16];
+		unsigned long value = rng_skewed(rng, 5000);
+		unsigned long noise = rng_next(rng);
+		int i;
+
+		addr += 4 * (1 + rng_skewed(rng, 64));
+
+		for (i = 0; i < 4; ++i) {
+			rec[i] = (byte) (id >> (8 * i));
+			rec[4 + i] = (byte) (addr >> (8 * i));
+		}
+
+		rec[8] = (byte) rng_skewed(rng, 8);
+		rec[9] = (byte) (rng_below(rng, 4) == 0 ? 0x80 : 0x00);
+		rec[10] = (byte) value;
+		rec[11] = (byte) (value >> 8);
+		rec[12] = (byte) noise;
+		rec[13] = (byte) (noise >> 8);
+		rec[14] = 0;
+		rec[15] = 0;
+
+		++id;
+
+		put_bytes(data, size, &pos, (const char *) rec, sizeof(rec));
+	}
+}
+
+static void
+generate_random(byte *data, unsigned long size, struct rng *rng)
+{
+	unsigned long i;
+
+	for (i = 0; i < size; ++i) {
+		data[i] = (byte) (rng_next(rng) >> 11);
+	}
+}
+
+/*
+ * A short pattern repeated, with an occasional change.
+ */
+static void
+generate_repeat(byte *data, unsigned long size, struct rng *rng)
+{
+	const unsigned long period = 40 + rng_below(rng, 200);
+	unsigned long i;
+
+	generate_random(data, period < size ? period : size, rng);
+
+	for (i = period; i < size; ++i) {
+		data[i] = rng_below(rng, 4096) == 0 ? (byte) rng_next(rng) : data[i - period];
+	}
+}
+
+/*
+ * Runs of zeros between short stretches of random bytes, like sparse
+ * data and padded structures.
+ */
+static void
+generate_zeros(byte *data, unsigned long size, struct rng *rng)
+{
+	unsigned long pos = 0;
+
+	while (pos < size) {
+		unsigned long len = 1 + rng_skewed(rng, 4096);
+
+		if (len > size - pos) {
+			len = size - pos;
+		}
+
+		memset(data + pos, 0, len);
+		pos += len;
+
+		for (len = rng_below(rng, 32); len > 0 && pos < size; --len) {
+			data[pos++] = (byte) rng_next(rng);
+		}
+	}
+}
+
+static const struct {
+	const char *name;
+	void (*generate)(byte *, unsigned long, struct rng *);
+} kinds[] = {
+	{ "text", generate_text },
+	{ "log", generate_log },
+	{ "binary", generate_binary },
+	{ "random", generate_random },
+	{ "repeat", generate_repeat },
+	{ "zeros", generate_zeros }
+};
+
+#define NUM_KINDS (sizeof(kinds) / sizeof(kinds[0]))
+
+/*
+ * Sizes of generated data.
+ */
+static const unsigned long sizes[] = { 16 * 1024UL, 256 * 1024UL, 4 * 1024 * 1024UL };
+
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static int
+find_kind(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < NUM_KINDS; ++i) {
+		if (strcmp(name, kinds[i].name) == 0) {
+			return (int) i;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Fill `data` with `size` bytes of data of kind `kind`. The seed depends
+ * only on the kind, so the data is the same on every run.
+ */
+static void
+generate(int kind, byte *data, unsigned long size)
+{
+	struct rng rng;
+
+	rng.x = 2463534242UL + (unsigned long) kind;
+
+	kinds[kind].generate(data, size, &rng);
+}
+
+/*
+ * Get throughput in MB/s of processing `size` bytes `iterations` times in
+ * `clocks`.
+ */
+static double
+mb_per_sec(unsigned long size, unsigned long iterations, clock_t clocks)
+{
+	const double secs = (double) clocks / (double) CLOCKS_PER_SEC;
+
+	return secs > 0.0 ? (double) size * (double) iterations / 1e6 / secs : 0.0;
+}
+
+static double
+bench_pack(const byte *data, byte *packed, unsigned long size,
+           void *workmem, int level, unsigned long *packed_size)
+{
+	double best = 0.0;
+	int run;
+
+	for (run = 0; run < NUM_RUNS; ++run) {
+		unsigned long iterations = 0;
+		clock_t start = clock();
+		clock_t clocks;
+		double speed;
+
+		do {
+			*packed_size = lz4_pack_level(data, packed, size, workmem, level);
+			++iterations;
+		} while ((clocks = clock() - start) < MIN_CLOCKS);
+
+		speed = mb_per_sec(size, iterations, clocks);
+
+		if (speed > best) {
+			best = speed;
+		}
+	}
+
+	return best;
+}
+
+static double
+bench_depack(const byte *packed, unsigned long packed_size, byte *out,
+             unsigned long size)
+{
+	double best = 0.0;
+	int run;
+
+	for (run = 0; run < NUM_RUNS; ++run) {
+		unsigned long iterations = 0;
+		clock_t start = clock();
+		clock_t clocks;
+		double speed;
+
+		do {
+			lz4_depack(packed, out, packed_size);
+			++iterations;
+		} while ((clocks = clock() - start) < MIN_CLOCKS);
+
+		speed = mb_per_sec(size, iterations, clocks);
+
+		if (speed > best) {
+			best = speed;
+		}
+	}
+
+	return best;
+}
+
+/*
+ * Write generated data of each kind and size to files in `dir`, for use
+ * with other tools like `blz4 -b`.
+ */
+static int
+write_corpus(const char *dir, const int *selected, int num_selected)
+{
+	byte *data = NULL;
+	int res = EXIT_FAILURE;
+	int i;
+
+	if ((data = (byte *) malloc(sizes[NUM_SIZES - 1])) == NULL) {
+		fputs("lz4bench: not enough memory\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < num_selected; ++i) {
+		size_t j;
+
+		for (j = 0; j < NUM_SIZES; ++j) {
+			char name[FILENAME_MAX];
+			FILE *f;
+
+			generate(selected[i], data, sizes[j]);
+
+			if (snprintf(name, sizeof(name), "%s/%s-%lu", dir,
+			             kinds[selected[i]].name, sizes[j]) >= (int) sizeof(name)
+			 || (f = fopen(name, "wb")) == NULL) {
+				fprintf(stderr, "lz4bench: unable to create '%s'\n", name);
+				goto out;
+			}
+
+			fwrite(data, 1, sizes[j], f);
+			fclose(f);
+		}
+	}
+
+	res = EXIT_SUCCESS;
+
+out:
+	free(data);
+
+	return res;
+}
+
+static void
+print_syntax(void)
+{
+	fputs("usage: lz4bench [options] [KIND...]\n"
+	      "\n"
+	      "Benchmark lz4_pack_level at every level and lz4_depack on generated\n"
+	      "data of each KIND (text, log, binary, random, repeat, zeros), or all.\n"
+	      "\n"
+	      "options:\n"
+	      "      --json=FILE  write results as JSON to FILE instead of stdout\n"
+	      "      --write=DIR  write the generated data to files in DIR and exit\n"
+	      "  -h, --help       print this help and exit\n", stdout);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct parg_state ps;
+	const char *json_name = NULL;
+	const char *write_dir = NULL;
+	FILE *json = stdout;
+	byte *data = NULL;
+	byte *packed = NULL;
+	byte *out = NULL;
+	void *workmem = NULL;
+	size_t workmem_size = 0;
+	const unsigned long max_size = sizes[NUM_SIZES - 1];
+	int selected[NUM_KINDS];
+	int num_selected = 0;
+	int first = 1;
+	int res = EXIT_FAILURE;
+	int i, c;
+
+	const struct parg_option long_options[] = {
+		{ "help", PARG_NOARG, NULL, 'h' },
+		{ "json", PARG_REQARG, NULL, 'j' },
+		{ "write", PARG_REQARG, NULL, 'w' },
+		{ 0, 0, 0, 0 }
+	};
+
+	parg_init(&ps);
+
+	while ((c = parg_getopt_long(&ps, argc, argv, "h", long_options, NULL)) != -1) {
+		switch (c) {
+		case 1:
+			if ((i = find_kind(ps.optarg)) < 0) {
+				fprintf(stderr, "lz4bench: unknown kind of data '%s'\n", ps.optarg);
+				return EXIT_FAILURE;
+			}
+			if (num_selected < (int) NUM_KINDS) {
+				selected[num_selected++] = i;
+			}
+			break;
+		case 'j':
+			json_name = ps.optarg;
+			break;
+		case 'w':
+			write_dir = ps.optarg;
+			break;
+		case 'h':
+			print_syntax();
+			return EXIT_SUCCESS;
+		default:
+			fprintf(stderr, "lz4bench: unknown option '%s'\n", argv[ps.optind - 1]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (num_selected == 0) {
+		for (i = 0; i < (int) NUM_KINDS; ++i) {
+			selected[num_selected++] = i;
+		}
+	}
+
+	if (write_dir != NULL) {
+		return write_corpus(write_dir, selected, num_selected);
+	}
+
+	/* Use workmem large enough for all levels */
+	for (i = 1; i <= MAX_LEVEL; ++i) {
+		if (lz4_workmem_size_level(max_size, i) > workmem_size) {
+			workmem_size = lz4_workmem_size_level(max_size, i);
+		}
+	}
+
+	if ((data = (byte *) malloc(max_size)) == NULL
+	 || (packed = (byte *) malloc(lz4_max_packed_size(max_size))) == NULL
+	 || (out = (byte *) malloc(max_size)) == NULL
+	 || (workmem = malloc(workmem_size)) == NULL) {
+		fputs("lz4bench: not enough memory\n", stderr);
+		goto out;
+	}
+
+	if (json_name != NULL && (json = fopen(json_name, "w")) == NULL) {
+		fprintf(stderr, "lz4bench: unable to create '%s'\n", json_name);
+		goto out;
+	}
+
+	fprintf(json, "{\n"
+	        "  \"version\": \"%s\",\n"
+	        "  \"kernel\": \"%s\",\n"
+	        "  \"results\": [",
+	        LZ4_VER_STRING, lz4_kernel_name(lz4_get_kernel()));
+
+	for (i = 0; i < num_selected; ++i) {
+		size_t j;
+
+		for (j = 0; j < NUM_SIZES; ++j) {
+			const unsigned long size = sizes[j];
+			int level;
+
+			generate(selected[i], data, size);
+
+			for (level = 1; level <= MAX_LEVEL; ++level) {
+				unsigned long packed_size = 0;
+				double pack_speed, depack_speed;
+
+				pack_speed = bench_pack(data, packed, size, workmem, level, &packed_size);
+
+				memset(out, 0, size);
+
+				if (lz4_depack(packed, out, packed_size) != size
+				 || memcmp(data, out, size) != 0) {
+					fprintf(stderr, "lz4bench: decompressed data mismatch for %s-%lu at level %d\n",
+					        kinds[selected[i]].name, size, level);
+					goto out;
+				}
+
+				depack_speed = bench_depack(packed, packed_size, out, size);
+
+				fprintf(json, "%s\n    { \"data\": \"%s\", \"size\": %lu, \"level\": %d, "
+				        "\"packed_size\": %lu, \"pack_mb_per_sec\": %.2f, "
+				        "\"depack_mb_per_sec\": %.2f }",
+				        first ? "" : ",", kinds[selected[i]].name, size, level,
+				        packed_size, pack_speed, depack_speed);
+				first = 0;
+
+				fprintf(stderr, "%-6s %8lu %2d %8lu %9.2f MB/s %9.2f MB/s\n",
+				        kinds[selected[i]].name, size, level, packed_size,
+				        pack_speed, depack_speed);
+			}
+		}
+	}
+
+	fputs("\n  ]\n}\n", json);
+
+	res = EXIT_SUCCESS;
+
+out:
+	if (json != stdout) {
+		fclose(json);
+	}
+
+	free(workmem);
+	free(out);
+	free(packed);
+	free(data);
+
+	return res;
+}
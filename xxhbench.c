@@ -0,0 +1,266 @@
+/*
+ * xxhbench - Benchmark of xxHash32 against LZ4 decompression
+ *
+ * Copyright (c) 2026 Joergen Ibsen
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ *   1. The origin of this software must not be misrepresented; you must
+ *      not claim that you wrote the original software. If you use this
+ *      software in a product, an acknowledgment in the product
+ *      documentation would be appreciated but is not required.
+ *
+ *   2. Altered source versions must be plainly marked as such, and must
+ *      not be misrepresented as being the original software.
+ *
+ *   3. This notice may not be removed or altered from any source
+ *      distribution.
+ */
+
+#ifdef _MSC_VER
+#  define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lz4.h"
+
+/*
+ * Size of generated data used if no file is given.
+ */
+#define GENERATED_SIZE (8 * 1024 * 1024UL)
+
+/*
+ * Number of times each measurement is repeated, the fastest is used.
+ */
+#define NUM_RUNS 5
+
+/*
+ * Minimum time in clocks of each measurement.
+ */
+#define MIN_CLOCKS (CLOCKS_PER_SEC / 4)
+
+static volatile unsigned long sink;
+
+static unsigned long safe_capacity;
+
+static unsigned long
+depack_safe(const void *src, void *dst, unsigned long packed_size)
+{
+	return lz4_depack_safe(src, dst, packed_size, safe_capacity);
+}
+
+/*
+ * Fill `data` with text-like data that compresses to roughly half.
+ */
+static void
+generate_data(unsigned char *data, unsigned long size)
+{
+	static const char *const words[] = {
+		"the ", "block ", "frame ", "match ", "offset ", "literal ",
+		"length ", "checksum ", "of ", "and ", "data ", "stream "
+	};
+	unsigned long seed = 1;
+	unsigned long i = 0;
+
+	while (i < size) {
+		const char *word;
+		size_t len;
+
+		seed = seed * 1103515245UL + 12345UL;
+
+		/* Mix in some random bytes to keep the ratio realistic */
+		if (((seed >> 16) & 7) == 0) {
+			data[i++] = (unsigned char) (seed >> 24);
+			continue;
+		}
+
+		word = words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+		len = strlen(word);
+
+		if (len > size - i) {
+			len = size - i;
+		}
+
+		memcpy(data + i, word, len);
+		i += len;
+	}
+}
+
+static unsigned char *
+read_file(const char *name, unsigned long *size)
+{
+	FILE *f = NULL;
+	unsigned char *data = NULL;
+	long len;
+
+	if ((f = fopen(name, "rb")) == NULL
+	 || fseek(f, 0, SEEK_END) != 0
+	 || (len = ftell(f)) <= 0
+	 || fseek(f, 0, SEEK_SET) != 0
+	 || (data = (unsigned char *) malloc((size_t) len)) == NULL
+	 || fread(data, 1, (size_t) len, f) != (size_t) len) {
+		free(data);
+		data = NULL;
+	}
+	else {
+		*size = (unsigned long) len;
+	}
+
+	if (f != NULL) {
+		fclose(f);
+	}
+
+	return data;
+}
+
+/*
+ * Get throughput in GB/s of processing `size` bytes `iterations` times in
+ * `clocks`.
+ */
+static double
+gb_per_sec(unsigned long size, unsigned long iterations, clock_t clocks)
+{
+	const double secs = (double) clocks / (double) CLOCKS_PER_SEC;
+
+	return secs > 0.0 ? (double) size * (double) iterations / 1e9 / secs : 0.0;
+}
+
+static double
+bench_xxh32(const unsigned char *data, unsigned long size)
+{
+	double best = 0.0;
+	int run;
+
+	for (run = 0; run < NUM_RUNS; ++run) {
+		unsigned long iterations = 0;
+		clock_t start = clock();
+		clock_t clocks;
+		double speed;
+
+		do {
+			sink = lz4_xxh32(data, size, 0);
+			++iterations;
+		} while ((clocks = clock() - start) < MIN_CLOCKS);
+
+		speed = gb_per_sec(size, iterations, clocks);
+
+		if (speed > best) {
+			best = speed;
+		}
+	}
+
+	return best;
+}
+
+static double
+bench_depack(unsigned long (*depack)(const void *, void *, unsigned long),
+             const unsigned char *packed, unsigned long packed_size,
+             unsigned char *out, unsigned long size)
+{
+	double best = 0.0;
+	int run;
+
+	for (run = 0; run < NUM_RUNS; ++run) {
+		unsigned long iterations = 0;
+		clock_t start = clock();
+		clock_t clocks;
+		double speed;
+
+		do {
+			sink = depack(packed, out, packed_size);
+			++iterations;
+		} while ((clocks = clock() - start) < MIN_CLOCKS);
+
+		speed = gb_per_sec(size, iterations, clocks);
+
+		if (speed > best) {
+			best = speed;
+		}
+	}
+
+	return best;
+}
+
+int
+main(int argc, char *argv[])
+{
+	unsigned char *data = NULL;
+	unsigned char *packed = NULL;
+	unsigned char *out = NULL;
+	void *workmem = NULL;
+	unsigned long size = GENERATED_SIZE;
+	unsigned long packed_size;
+	double xxh_speed, depack_speed, fast_speed, safe_speed;
+	int res = EXIT_FAILURE;
+
+	if (argc > 2) {
+		fputs("usage: xxhbench [FILE]\n", stderr);
+		return EXIT_FAILURE;
+	}
+
+	if (argc == 2) {
+		if ((data = read_file(argv[1], &size)) == NULL) {
+			fprintf(stderr, "xxhbench: unable to read '%s'\n", argv[1]);
+			goto out;
+		}
+	}
+	else if ((data = (unsigned char *) malloc(size)) != NULL) {
+		generate_data(data, size);
+	}
+
+	if (data == NULL
+	 || (packed = (unsigned char *) malloc(lz4_max_packed_size(size))) == NULL
+	 || (out = (unsigned char *) malloc(size + LZ4_DEPACK_FAST_SLACK)) == NULL
+	 || (workmem = malloc(lz4_workmem_size_level(size, 1))) == NULL) {
+		fputs("xxhbench: not enough memory\n", stderr);
+		goto out;
+	}
+
+	packed_size = lz4_pack_level(data, packed, size, workmem, 1);
+
+	if (lz4_depack(packed, out, packed_size) != size
+	 || memcmp(data, out, size) != 0
+	 || lz4_depack_fast(packed, out, packed_size) != size
+	 || memcmp(data, out, size) != 0
+	 || lz4_depack_safe(packed, out, packed_size, size) != size
+	 || memcmp(data, out, size) != 0) {
+		fputs("xxhbench: decompressed data mismatch\n", stderr);
+		goto out;
+	}
+
+	xxh_speed = bench_xxh32(data, size);
+	depack_speed = bench_depack(lz4_depack, packed, packed_size, out, size);
+	fast_speed = bench_depack(lz4_depack_fast, packed, packed_size, out, size);
+	safe_capacity = size;
+	safe_speed = bench_depack(depack_safe, packed, packed_size, out, size);
+
+	printf("data         %lu bytes, level 1 ratio %.1f%%\n", size,
+	       100.0 * (double) packed_size / (double) size);
+	printf("xxh32        %.2f GB/s\n", xxh_speed);
+	printf("lz4_depack   %.2f GB/s (%s kernels)\n", depack_speed,
+	       lz4_kernel_name(lz4_get_kernel()));
+	printf("depack_fast  %.2f GB/s\n", fast_speed);
+	printf("depack_safe  %.2f GB/s\n", safe_speed);
+	printf("xxh32 is %.1fx the speed of lz4_depack\n",
+	       depack_speed > 0.0 ? xxh_speed / depack_speed : 0.0);
+
+	res = EXIT_SUCCESS;
+
+out:
+	free(workmem);
+	free(out);
+	free(packed);
+	free(data);
+
+	return res;
+}